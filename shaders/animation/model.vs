@@ -25,18 +25,35 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform mat4 boneMatrices[MAX_BONES];
 
+// Meshes baked as assets::PackedVertex: positions are unorm16 inside the mesh bounds,
+// normals are octahedral encoded
+uniform bool packedVertices;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
 void main()
 {
+    vec3 position = packedVertices ? aPos * positionScale + positionOffset : aPos;
+    vec3 normal = packedVertices ? octahedralDecode(aNormal.xy) : aNormal;
+
     TexCoords = aTexCoords;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = mat3(transpose(inverse(model))) * normal;
 
-    BoneData vertexData = data[id];
+    // Packed vertices have no ID attribute, it always equals the vertex index
+    BoneData vertexData = data[packedVertices ? uint(gl_VertexID) : id];
     mat4 boneTransform = mat4(0.0f);
     for (int i = 0; i < MAX_BONES_PER_VERTEX; i++) {
         boneTransform += boneMatrices[vertexData.boneIDs[i]] * vertexData.weights[i];
     }
 
-    vec4 posWithBone = boneTransform * vec4(aPos, 1.0);
+    vec4 posWithBone = boneTransform * vec4(position, 1.0);
     FragPos = vec3(model * posWithBone);
     gl_Position = projection * view * model * posWithBone;
 }
\ No newline at end of file
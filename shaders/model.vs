@@ -13,11 +13,27 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform mat4 lightSpaceMatrix;
 
+// Meshes baked as assets::PackedVertex: positions are unorm16 inside the mesh bounds,
+// normals are octahedral encoded
+uniform bool packedVertices;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
 void main()
 {
+    vec3 position = packedVertices ? aPos * positionScale + positionOffset : aPos;
+    vec3 normal = packedVertices ? octahedralDecode(aNormal.xy) : aNormal;
+
     TexCoords = aTexCoords;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    FragPos = vec3(model * vec4(position, 1.0));
     FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
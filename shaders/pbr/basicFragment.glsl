@@ -30,7 +30,9 @@ uniform Light lights[MAX_NUM_LIGHTS];
 
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(texture_normal, TexCoords).xyz * 2.0 - 1.0;
+    // Baked normal maps are BC5 and only keep x and y
+    vec2 tangentXY = texture(texture_normal, TexCoords).xy * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(1.0 - dot(tangentXY, tangentXY), 0.0)));
 
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
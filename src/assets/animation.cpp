@@ -4,39 +4,34 @@
 
 #include "animation.h"
 
+#include <cmath>
 #include <glm/gtx/quaternion.hpp>
 
-std::vector<glm::mat4> Animation::getBoneTransforms(float time, const aiScene* scene,
-                                                    std::vector<NodeData>&nodeData, int animationIndex) {
+std::vector<glm::mat4> Animation::getBoneTransforms(float time, const AnimationClip& clip,
+                                                    std::vector<NodeData>&nodeData) {
     std::vector<glm::mat4> finalTransforms(bone_info.size());
-    const aiAnimation* animation = scene->mAnimations[animationIndex];
 
-    float ticksPerSecond = animation->mTicksPerSecond != 0
-                               ? animation->mTicksPerSecond
-                               : 25.0f;
-    float timeInTicks = time * ticksPerSecond;
-    float animationTimeTicks = fmod(timeInTicks, animation->mDuration);
+    float timeInTicks = time * clip.ticksPerSecond;
+    float animationTimeTicks = clip.duration > 0.0f ? fmod(timeInTicks, clip.duration) : 0.0f;
 
     glm::mat4 identity(1.0f);
 
-    for (int i = 0; i < nodeData.size(); i++) {
+    for (size_t i = 0; i < nodeData.size(); i++) {
         NodeData&node = nodeData[i];
-        const aiNodeAnim* nodeAnim = findNodeAnim(animation, node.name);
+        int channelIndex = i < clip.nodeChannels.size() ? clip.nodeChannels[i] : -1;
+        const NodeChannel* channel = channelIndex >= 0 ? &clip.channels[channelIndex] : nullptr;
         glm::mat4 totalTransform = node.originalTransform;
 
-        if (nodeAnim) {
-            const aiVector3D scaling = calcInterpolatedTransform(animationTimeTicks, nodeAnim->mNumScalingKeys,
-                                                                 nodeAnim->mScalingKeys);
-            glm::mat4 scalingMatrix = glm::scale(identity, glm::vec3(scaling.x, scaling.y, scaling.z));
+        if (channel) {
+            const glm::vec3 scaling = calcInterpolatedTransform(animationTimeTicks, channel->scales, glm::vec3(1.0f));
+            glm::mat4 scalingMatrix = glm::scale(identity, scaling);
 
-            const aiQuaternion rotationQ = calcInterpolatedRotation(animationTimeTicks, nodeAnim);
-            glm::quat rotateQ(rotationQ.w, rotationQ.x, rotationQ.y, rotationQ.z);
+            const glm::quat rotateQ = calcInterpolatedRotation(animationTimeTicks, channel->rotations);
             glm::mat4 rotationMatrix = glm::toMat4(rotateQ);
 
-            const aiVector3D translation = calcInterpolatedTransform(animationTimeTicks, nodeAnim->mNumPositionKeys,
-                                                                     nodeAnim->mPositionKeys);
-            glm::mat4 translationMatrix = glm::translate(
-                identity, glm::vec3(translation.x, translation.y, translation.z));
+            const glm::vec3 translation = calcInterpolatedTransform(animationTimeTicks, channel->positions,
+                                                                    glm::vec3(0.0f));
+            glm::mat4 translationMatrix = glm::translate(identity, translation);
 
             totalTransform = translationMatrix * rotationMatrix * scalingMatrix;
         }
@@ -44,8 +39,8 @@ std::vector<glm::mat4> Animation::getBoneTransforms(float time, const aiScene* s
         glm::mat4 parentTrasform = node.parentIndex == -1 ? identity : nodeData[node.parentIndex].transformation;
         node.transformation = parentTrasform * totalTransform;
 
-        if (boneName_To_Index.find(node.name) != boneName_To_Index.end()) {
-            unsigned int boneIndex = boneName_To_Index[node.name];
+        int boneIndex = i < nodeBones.size() ? nodeBones[i] : -1;
+        if (boneIndex >= 0) {
             finalTransforms[boneIndex] = node.transformation * bone_info[boneIndex].offsetTransform;
         }
     }
@@ -53,66 +48,81 @@ std::vector<glm::mat4> Animation::getBoneTransforms(float time, const aiScene* s
     return finalTransforms;
 }
 
-aiVector3D calcInterpolatedTransform(float animationTicks, unsigned numKeys, aiVectorKey* keys) {
-    if (numKeys == 1) {
-        return keys[0].mValue;
+void Animation::bindSkeleton(const std::vector<NodeData>& nodeData) {
+    nodeBones.assign(nodeData.size(), -1);
+    for (size_t i = 0; i < nodeData.size(); i++) {
+        auto bone = boneName_To_Index.find(nodeData[i].name);
+        if (bone != boneName_To_Index.end() && bone->second < bone_info.size()) {
+            nodeBones[i] = bone->second;
+        }
+    }
+}
+
+void bindClip(AnimationClip& clip, const std::vector<NodeData>& nodeData) {
+    // The first channel of a name wins, like findNodeChannel
+    std::unordered_map<std::string, int> channelsByName;
+    for (size_t i = 0; i < clip.channels.size(); i++) {
+        channelsByName.emplace(clip.channels[i].nodeName, (int) i);
     }
 
-    unsigned int transformIndex = 0;
-    for (unsigned int i = 0; i < numKeys - 1; i++) {
-        if (animationTicks < keys[i + 1].mTime) {
-            transformIndex = i;
-            break;
+    clip.nodeChannels.assign(nodeData.size(), -1);
+    for (size_t i = 0; i < nodeData.size(); i++) {
+        auto channel = channelsByName.find(nodeData[i].name);
+        if (channel != channelsByName.end()) {
+            clip.nodeChannels[i] = channel->second;
         }
     }
+}
 
-    unsigned int nextTransformIndex = transformIndex + 1;
-    double time1 = keys[transformIndex].mTime, time2 = keys[nextTransformIndex].mTime;
+namespace {
+    // Index of the key starting the interval animationTicks falls in, the last key when it is past all of them
+    template<typename Key>
+    size_t findKeyInterval(float animationTicks, const std::vector<Key>& keys) {
+        for (size_t i = 0; i + 1 < keys.size(); i++) {
+            if (animationTicks < keys[i + 1].time) return i;
+        }
+        return keys.size() - 1;
+    }
+}
 
-    double deltaTime = time2 - time1;
-    float factor = (animationTicks - time1) / deltaTime;
+glm::vec3 calcInterpolatedTransform(float animationTicks, const std::vector<VectorKey>& keys, const glm::vec3& fallback) {
+    if (keys.empty()) {
+        return fallback;
+    }
+
+    size_t transformIndex = findKeyInterval(animationTicks, keys);
+    if (transformIndex + 1 == keys.size()) {
+        return keys[transformIndex].value;
+    }
+
+    const VectorKey &start = keys[transformIndex], &end = keys[transformIndex + 1];
+    float deltaTime = end.time - start.time;
+    float factor = glm::clamp((animationTicks - start.time) / deltaTime, 0.0f, 1.0f);
 
-    const aiVector3D &start = keys[transformIndex].mValue,
-            end = keys[nextTransformIndex].mValue;
-    const aiVector3D delta = end - start;
-    return start + factor * delta;
+    return start.value + factor * (end.value - start.value);
 }
 
-aiQuaternion calcInterpolatedRotation(float animationTicks, const aiNodeAnim* nodeAnim) {
-    if (nodeAnim->mNumRotationKeys == 1) {
-        return nodeAnim->mRotationKeys[0].mValue;
+glm::quat calcInterpolatedRotation(float animationTicks, const std::vector<RotationKey>& keys) {
+    if (keys.empty()) {
+        return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
     }
 
-    unsigned int rotationIndex = 0;
-    for (unsigned int i = 0; i < nodeAnim->mNumRotationKeys - 1; i++) {
-        float t = nodeAnim->mRotationKeys[i + 1].mTime;
-        if (animationTicks < t) {
-            rotationIndex = i;
-            break;
-        }
+    size_t rotationIndex = findKeyInterval(animationTicks, keys);
+    if (rotationIndex + 1 == keys.size()) {
+        return keys[rotationIndex].value;
     }
-    unsigned int nextRotationIndex = rotationIndex + 1;
-    assert(nextRotationIndex < nodeAnim->mNumRotationKeys);
-
-    float t1 = nodeAnim->mRotationKeys[rotationIndex].mTime,
-            t2 = nodeAnim->mRotationKeys[nextRotationIndex].mTime;
 
-    float deltaTime = t2 - t1;
-    float factor = (animationTicks - t1) / deltaTime;
-    const aiQuaternion &start = nodeAnim->mRotationKeys[rotationIndex].mValue,
-            end = nodeAnim->mRotationKeys[nextRotationIndex].mValue;
+    const RotationKey &start = keys[rotationIndex], &end = keys[rotationIndex + 1];
+    float deltaTime = end.time - start.time;
+    float factor = glm::clamp((animationTicks - start.time) / deltaTime, 0.0f, 1.0f);
 
-    aiQuaternion output{};
-    aiQuaternion::Interpolate(output, start, end, factor);
-    return output.Normalize();
+    return glm::normalize(glm::slerp(start.value, end.value, factor));
 }
 
-const aiNodeAnim* findNodeAnim(const aiAnimation* animation, const std::string&nodeName) {
-    for (unsigned int i = 0; i < animation->mNumChannels; i++) {
-        const aiNodeAnim* nodeAnim = animation->mChannels[i];
-
-        if (std::string(nodeAnim->mNodeName.data) == nodeName) {
-            return nodeAnim;
+const NodeChannel* findNodeChannel(const AnimationClip& clip, const std::string&nodeName) {
+    for (const NodeChannel& channel : clip.channels) {
+        if (channel.nodeName == nodeName) {
+            return &channel;
         }
     }
     return nullptr;
@@ -4,7 +4,10 @@
 
 #ifndef ANIMATION_H
 #define ANIMATION_H
-#include <assimp/scene.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/gtc/quaternion.hpp>
 #include <utils/types.h>
 
 struct NodeData {
@@ -14,22 +17,62 @@ struct NodeData {
     int parentIndex;
 };
 
+// Keys are in ticks of their clip
+struct VectorKey {
+    float time;
+    glm::vec3 value;
+};
+
+struct RotationKey {
+    float time;
+    glm::quat value;
+};
+
+// How one node moves over a clip
+struct NodeChannel {
+    std::string nodeName;
+    std::vector<VectorKey> positions;
+    std::vector<RotationKey> rotations;
+    std::vector<VectorKey> scales;
+};
+
+// An animation of a model, copied out of the importer so it can be baked and played back from a pack
+struct AnimationClip {
+    std::string name;
+    float duration = 0.0f;
+    float ticksPerSecond = 25.0f;
+    std::vector<NodeChannel> channels;
+
+    // Channel moving each node of the model the clip is bound to, -1 for nodes it leaves alone. Filled
+    // by bindClip and never baked.
+    std::vector<int> nodeChannels;
+};
+
 struct Animation {
     std::vector<VertexBoneData> bone_data;
     std::vector<BoneInfo> bone_info;
     std::unordered_map<std::string, unsigned int> boneName_To_Index;
 
-    unsigned int animationSSBO;
+    unsigned int animationSSBO = 0;
+
+    // Bone of this skin each node of the model is, -1 for the rest. Filled by bindSkeleton.
+    std::vector<int> nodeBones;
 
-    std::vector<glm::mat4> getBoneTransforms(float time, const aiScene* scene, std::vector<NodeData>&nodeData,
-                                             int animationIndex = 0);
+    void bindSkeleton(const std::vector<NodeData>& nodeData);
+    // Samples by index only, so the clip and this skin have to be bound to nodeData first.
+    // Nodes without a binding keep their rest pose.
+    std::vector<glm::mat4> getBoneTransforms(float time, const AnimationClip& clip, std::vector<NodeData>&nodeData);
 };
 
-aiVector3D calcInterpolatedTransform(float animationTicks, unsigned int numKeys, aiVectorKey* keys);
+// Resolves the clip's channels to node indices once, so sampling never compares names
+void bindClip(AnimationClip& clip, const std::vector<NodeData>& nodeData);
+
+// Keys are sorted by time. Times past the last key hold it, fallback is used when there are no keys.
+glm::vec3 calcInterpolatedTransform(float animationTicks, const std::vector<VectorKey>& keys, const glm::vec3& fallback);
 
-aiQuaternion calcInterpolatedRotation(float animationTicks, const aiNodeAnim* nodeAnim);
+glm::quat calcInterpolatedRotation(float animationTicks, const std::vector<RotationKey>& keys);
 
-const aiNodeAnim* findNodeAnim(const aiAnimation* animation, const std::string&nodeName);
+const NodeChannel* findNodeChannel(const AnimationClip& clip, const std::string&nodeName);
 
 void addBoneData(VertexBoneData&data, unsigned int boneID, float weight);
 #endif //ANIMATION_H
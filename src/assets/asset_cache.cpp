@@ -0,0 +1,96 @@
+#include "asset_cache.h"
+#include "asset_file.h"
+
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+    constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+
+    uint64_t mix(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    bool readFileStats(const std::string& path, uint64_t& size, int64_t& modifiedTime) {
+        std::error_code error;
+        size = std::filesystem::file_size(path, error);
+        if (error) return false;
+
+        modifiedTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        return !error;
+    }
+
+    bool hashFile(const std::string& path, uint64_t& hash) {
+        assets::MappedFile mapping;
+        if (!mapping.open(path)) {
+            // Mapping fails on empty files
+            std::error_code error;
+            if (std::filesystem::file_size(path, error) != 0 || error) return false;
+
+            hash = assets::hashBytes(nullptr, 0);
+            return true;
+        }
+
+        hash = assets::hashBytes(mapping.data(), mapping.size());
+        return true;
+    }
+}
+
+uint64_t assets::hashBytes(const void* data, size_t size, uint64_t seed) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ (size * PRIME);
+
+    // Four independent lanes keep the multiplies from serializing on one register
+    uint64_t lanes[4] = {hash, hash + PRIME, hash ^ 0xD6E8FEB86659FD93ull, hash - PRIME};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            memcpy(&word, bytes + i + lane * 8, 8);
+            lanes[lane] = (lanes[lane] ^ mix(word)) * PRIME;
+        }
+    }
+    hash = mix(lanes[0]) ^ mix(lanes[1] + 1) ^ mix(lanes[2] + 2) ^ mix(lanes[3] + 3);
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ mix(word)) * PRIME;
+    }
+
+    // Empty inputs may come with a null pointer, which memcpy doesn't accept even for zero bytes
+    uint64_t tail = 0;
+    if (size > i) memcpy(&tail, bytes + i, size - i);
+    hash = (hash ^ mix(tail)) * PRIME;
+
+    return mix(hash);
+}
+
+uint64_t assets::hashString(const std::string& value) {
+    return hashBytes(value.data(), value.size());
+}
+
+bool assets::recordSourceFile(const std::string& path, SourceFile& file) {
+    file.path = path;
+    return readFileStats(path, file.size, file.modifiedTime) && hashFile(path, file.hash);
+}
+
+bool assets::isSourceUnchanged(const SourceFile& file) {
+    // Embedded data has no file of its own and changes along with the model
+    if (file.path.empty()) return true;
+
+    uint64_t size;
+    int64_t modifiedTime;
+    if (!readFileStats(file.path, size, modifiedTime)) return false;
+    if (size != file.size) return false;
+    if (modifiedTime == file.modifiedTime) return true;
+
+    uint64_t hash;
+    return hashFile(file.path, hash) && hash == file.hash;
+}
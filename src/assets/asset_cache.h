@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace assets {
+
+// A file an asset was built from, recorded so later runs can tell whether it changed
+struct SourceFile {
+    std::string path;
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint64_t hash = 0;
+};
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+uint64_t hashString(const std::string& value);
+
+bool recordSourceFile(const std::string& path, SourceFile& file);
+// Compares size and modification time first and only hashes the contents when those differ,
+// so touching a file without editing it doesn't count as a change
+bool isSourceUnchanged(const SourceFile& file);
+}
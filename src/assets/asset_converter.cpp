@@ -3,183 +3,784 @@
 //
 
 #include "asset_converter.h"
-#include <nlohmann/json.hpp>
-#include <lz4.h>
+#include "asset_json.h"
+#include "asset_metadata.h"
+#include "asset_pack.h"
+#include "block_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace {
+    size_t storedSize(const uint32_t* blocks, uint32_t count) {
+        size_t size = 0;
+        for (uint32_t i = 0; i < count; i++) size += blocks[i];
+        return size;
+    }
+
+    void setCodec(assets::AssetFile& file, const assets::CodecSettings& settings) {
+        file.codec = settings.codec;
+        file.codecLevel = assets::resolvedCodecLevel(settings);
+    }
+
+    void setFileType(assets::AssetFile& file, const char (&type)[5]) {
+        memcpy(file.type, type, 4);
+        file.version = assets::BINARY_METADATA_VERSION;
+    }
+
+    // Metadata of an asset as read from disk, either the binary headers in place or json converted to them
+    struct MetadataSource {
+        std::string upgraded;
+        std::string_view metadata;
+
+        bool read(const assets::AssetFileView& file, const char (&type)[5]) {
+            return assets::readBinaryMetadata(file, type, upgraded, metadata);
+        }
+    };
+}
+
+assets::CodecSettings BlobCodecs::forEntry(assets::PackEntryType type) const {
+    switch (type) {
+        case assets::PackEntryType::Mesh: return mesh;
+        case assets::PackEntryType::Skin: return mesh;
+        case assets::PackEntryType::Texture: return texture;
+        case assets::PackEntryType::Scene: return scene;
+        default: return {assets::Codec::None};
+    }
+}
 
 assets::AssetFile AssetConverter::convertMeshToBinary(Mesh& mesh) {
     assets::AssetFile file;
-    file.type[0] = 'M';
-    file.type[1] = 'E';
-    file.type[2] = 'S';
-    file.type[3] = 'H';
-    file.version = 1;
-
-    nlohmann::json metadata;
-    metadata["vertex_format"] = "PNTTB_F32";
-    size_t vertexBufferSize = mesh.vertices.size() * sizeof(Vertex);
-    size_t indexBufferSize = mesh.indices.size() * sizeof(unsigned);
-    metadata["vertex_buffer_size"] = vertexBufferSize;
-    metadata["indices_buffer_size"] = indexBufferSize;
-
-    std::vector<float> boundsData;
-    boundsData.resize(8);
-    boundsData[0] = mesh.aabb.maxPoint.x;
-    boundsData[1] = mesh.aabb.maxPoint.y;
-    boundsData[2] = mesh.aabb.maxPoint.z;
-    boundsData[3] = mesh.aabb.maxPoint.w;
-    boundsData[4] = mesh.aabb.minPoint.x;
-    boundsData[5] = mesh.aabb.minPoint.y;
-    boundsData[6] = mesh.aabb.minPoint.z;
-    boundsData[7] = mesh.aabb.minPoint.w;
-    metadata["bounds"] = boundsData;
-
-    std::vector<char> mergedBuffer;
-    mergedBuffer.resize(vertexBufferSize + indexBufferSize);
-    memcpy(mergedBuffer.data(), mesh.vertices.data(), vertexBufferSize);
-    memcpy(mergedBuffer.data() + vertexBufferSize, mesh.indices.data(), indexBufferSize);
-
-    int possibleCompressSize = LZ4_compressBound(mergedBuffer.size());
-    file.binaryBlob.resize(possibleCompressSize);
-
-    int compressedSize = LZ4_compress_default(mergedBuffer.data(), file.binaryBlob.data(), mergedBuffer.size(), possibleCompressSize);
-    file.binaryBlob.resize(compressedSize);
-
-    metadata["compression"] = "LZ4";
-    file.json = metadata.dump();
+    setFileType(file, "MESH");
+
+    assets::VertexFormat vertexFormat = mesh.vertexFormat;
+    const void* vertexData = mesh.packedVertices.data();
+    size_t vertexBufferSize = mesh.packedVertices.size();
+
+    // Meshes that came out of a pack may already be packed and are written back unchanged
+    std::vector<assets::PackedVertex> packedVertices;
+    if (vertexFormat == assets::VertexFormat::Float32) {
+        if (quantizeVertices) {
+            vertexFormat = assets::chooseVertexFormat(mesh.vertices.data(), mesh.vertices.size());
+        }
+
+        vertexData = mesh.vertices.data();
+        if (vertexFormat == assets::VertexFormat::Quantized16) {
+            packedVertices.resize(mesh.vertices.size());
+            assets::packVertices(mesh.vertices.data(), mesh.vertices.size(), mesh.aabb, packedVertices.data());
+            vertexData = packedVertices.data();
+        }
+        vertexBufferSize = mesh.vertices.size() * assets::vertexFormatStride(vertexFormat);
+    }
+
+    // 16 bit indices whenever every vertex is addressable with them
+    assets::IndexType indexType = mesh.indexType;
+    const void* indexData = mesh.indexData();
+    std::vector<uint16_t> shortIndices;
+    if (indexType == assets::IndexType::UInt32 && narrowIndices) {
+        indexType = assets::chooseIndexType(mesh.vertexCount());
+        if (indexType == assets::IndexType::UInt16) {
+            shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+            indexData = shortIndices.data();
+        }
+    }
+
+    assets::MeshHeader header{};
+    header.vertexFormat = (uint32_t) vertexFormat;
+    header.indexType = (uint32_t) indexType;
+    size_t indexBufferSize = mesh.indexCount() * assets::indexTypeSize(indexType);
+    header.vertexBufferSize = vertexBufferSize;
+    header.indexBufferSize = indexBufferSize;
+    memcpy(header.boundsMax, &mesh.aabb.maxPoint[0], sizeof(header.boundsMax));
+    memcpy(header.boundsMin, &mesh.aabb.minPoint[0], sizeof(header.boundsMin));
+    header.lodCount = mesh.lods.size();
+
+    // Vertices and indices are separate runs of blocks so each one can be decoded directly into the mesh
+    const assets::CodecSettings& settings = codecs.mesh;
+    header.codec = (uint32_t) settings.codec;
+    header.blockSize = assets::BLOCK_SIZE;
+    auto vertexBlocks = assets::compressBlocks(file.binaryBlob, vertexData, vertexBufferSize, settings);
+    auto indexBlocks = assets::compressBlocks(file.binaryBlob, indexData, indexBufferSize, settings);
+
+    // Meshlets follow the indices as raw structs
+    size_t meshletBufferSize = mesh.meshlets.size() * sizeof(Meshlet);
+    std::vector<uint32_t> meshletBlocks;
+    if (!mesh.meshlets.empty()) {
+        header.meshletCount = mesh.meshlets.size();
+        meshletBlocks = assets::compressBlocks(file.binaryBlob, mesh.meshlets.data(), meshletBufferSize, settings);
+    }
+    header.vertexBlockCount = vertexBlocks.size();
+    header.indexBlockCount = indexBlocks.size();
+    header.meshletBlockCount = meshletBlocks.size();
+
+    assets::MetadataWriter writer;
+    writer.write(header);
+    writer.writeArray(mesh.lods.data(), mesh.lods.size());
+    writer.writeArray(vertexBlocks.data(), vertexBlocks.size());
+    writer.writeArray(indexBlocks.data(), indexBlocks.size());
+    writer.writeArray(meshletBlocks.data(), meshletBlocks.size());
+
+    file.metadata = std::move(writer.data);
+    setCodec(file, settings);
+    file.rawBlobSize = vertexBufferSize + indexBufferSize + meshletBufferSize;
 
     return file;
 }
 
-Mesh AssetConverter::convertBinaryToMesh(const std::string& path) {
+bool AssetConverter::convertBinaryToMesh(const std::string& path, Mesh& mesh) {
+    assets::MappedFile mapping;
+    assets::AssetFileView file;
+    if (!assets::mapBinaryFile(path, mapping, file)) {
+        std::cout << "Failed to load mesh asset: " << path << "\n";
+        return false;
+    }
+
+    return convertBinaryToMesh(file, mesh);
+}
+
+bool AssetConverter::convertBinaryToMesh(const assets::AssetFileView& file, Mesh& mesh,
+                                         const assets::BlockCallback& onBlockDecoded) {
+    mesh = {};
+
+    MetadataSource source;
+    assets::MeshMetadata metadata{};
+    if (!source.read(file, "MESH") || !assets::readMeshMetadata(source.metadata, file.blobSize, metadata)) {
+        std::cout << "Unknown or corrupted mesh asset\n";
+        return false;
+    }
+    const assets::MeshHeader& header = metadata.header;
+    size_t vertexBufferSize = header.vertexBufferSize;
+    size_t indexBufferSize = header.indexBufferSize;
+    assets::Codec codec = (assets::Codec) header.codec;
+
+    mesh.aabb.maxPoint = glm::vec4(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2], header.boundsMax[3]);
+    mesh.aabb.minPoint = glm::vec4(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2], header.boundsMin[3]);
+    mesh.lods.assign(metadata.lods, metadata.lods + header.lodCount);
+    mesh.vertexFormat = (assets::VertexFormat) header.vertexFormat;
+    mesh.indexType = (assets::IndexType) header.indexType;
+
+    // Packed vertices are decoded straight into the buffer that gets uploaded
+    char* vertexDestination;
+    if (mesh.vertexFormat == assets::VertexFormat::Float32) {
+        mesh.vertices.resize(vertexBufferSize / sizeof(Vertex));
+        vertexDestination = reinterpret_cast<char*>(mesh.vertices.data());
+    }
+    else {
+        mesh.packedVertices.resize(vertexBufferSize);
+        vertexDestination = mesh.packedVertices.data();
+    }
+
+    char* indexDestination;
+    if (mesh.indexType == assets::IndexType::UInt16) {
+        mesh.shortIndices.resize(indexBufferSize / sizeof(uint16_t));
+        indexDestination = reinterpret_cast<char*>(mesh.shortIndices.data());
+    }
+    else {
+        mesh.indices.resize(indexBufferSize / sizeof(unsigned));
+        indexDestination = reinterpret_cast<char*>(mesh.indices.data());
+    }
+
+    size_t vertexStoredSize = storedSize(metadata.vertexBlocks, header.vertexBlockCount);
+    size_t indexStoredSize = storedSize(metadata.indexBlocks, header.indexBlockCount);
+
+    bool success =
+        assets::decompressBlocks(file.binaryBlob, vertexStoredSize, metadata.vertexBlocks, header.vertexBlockCount,
+            vertexDestination, vertexBufferSize, codec, header.blockSize, onBlockDecoded) &&
+        assets::decompressBlocks(file.binaryBlob + vertexStoredSize, indexStoredSize, metadata.indexBlocks,
+            header.indexBlockCount, indexDestination, indexBufferSize, codec, header.blockSize,
+            onBlockDecoded, vertexBufferSize);
+
+    if (success && header.meshletCount > 0) {
+        mesh.meshlets.resize(header.meshletCount);
+        size_t meshletOffset = vertexStoredSize + indexStoredSize;
+        success = assets::decompressBlocks(file.binaryBlob + meshletOffset, file.blobSize - meshletOffset,
+            metadata.meshletBlocks, header.meshletBlockCount, mesh.meshlets.data(),
+            mesh.meshlets.size() * sizeof(Meshlet), codec, header.blockSize);
+    }
+
+    // A partly decoded mesh is never handed out
+    if (!success) {
+        std::cout << "Mesh asset is corrupted\n";
+        mesh = {};
+    }
+
+    return success;
+}
+
+assets::AssetFile AssetConverter::convertTextureToBinary(Texture& texture) {
     assets::AssetFile file;
-    loadBinaryFile(path, file);
+    setFileType(file, "TEXI");
 
-    auto metadata = nlohmann::json::parse(file.json);
-    auto bounds = metadata["bounds"].get<std::vector<float>>();
-    size_t vertexBufferSize = metadata["vertex_buffer_size"];
-    size_t indexBufferSize = metadata["indices_buffer_size"];
-    size_t totalBufferSize = vertexBufferSize + indexBufferSize;
+    assets::TextureHeader header{};
+    memcpy(header.type, texture.type.data(), std::min(texture.type.size(), sizeof(header.type) - 1));
+    header.format = (uint32_t) texture.compression;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.nrComponents = texture.nrComponents;
+    header.mipLevels = texture.mipLevels;
 
-    Mesh mesh;
-    glm::vec4 maxPoint(bounds[0], bounds[1], bounds[2], bounds[3]);
-    glm::vec4 minPoint(bounds[4], bounds[5], bounds[6], bounds[7]);
-    mesh.aabb.maxPoint = maxPoint;
-    mesh.aabb.minPoint = minPoint;
+    size_t textureBufferSize = assets::textureDataSize(texture);
+    header.bufferSize = textureBufferSize;
 
-    std::vector<char> uncompressedData;
-    uncompressedData.resize(totalBufferSize);
-    LZ4_decompress_safe(file.binaryBlob.data(), uncompressedData.data(), file.binaryBlob.size(), totalBufferSize);
+    const assets::CodecSettings& settings = codecs.texture;
+    header.codec = (uint32_t) settings.codec;
+    header.blockSize = assets::BLOCK_SIZE;
+    auto blocks = assets::compressBlocks(file.binaryBlob, texture.data, textureBufferSize, settings);
+    header.blockCount = blocks.size();
 
-    std::vector<char> vertexBufferData;
-    std::vector<char> indexBufferData;
-    vertexBufferData.resize(vertexBufferSize);
-    indexBufferData.resize(indexBufferSize);
+    assets::MetadataWriter writer;
+    writer.write(header);
+    writer.writeArray(blocks.data(), blocks.size());
 
-    memcpy(vertexBufferData.data(), uncompressedData.data(), vertexBufferSize);
-    memcpy(indexBufferData.data(), uncompressedData.data() + vertexBufferSize, indexBufferSize);
+    file.metadata = std::move(writer.data);
+    setCodec(file, settings);
+    file.rawBlobSize = textureBufferSize;
 
-    std::vector<Vertex> vertices;
-    std::vector<unsigned> indices;
+    return file;
+}
 
-    size_t vertexVectorSize = vertexBufferSize / sizeof(Vertex);
-    size_t indexVectorSize = indexBufferSize / sizeof(unsigned);
+bool AssetConverter::convertBinaryToTexture(const std::string& path, Texture& texture) {
+    assets::MappedFile mapping;
+    assets::AssetFileView file;
+    if (!assets::mapBinaryFile(path, mapping, file)) {
+        std::cout << "Failed to load texture asset: " << path << "\n";
+        return false;
+    }
 
-    vertices.resize(vertexVectorSize);
-    indices.resize(indexVectorSize);
+    return convertBinaryToTexture(file, texture);
+}
 
-    auto* unpackedIndices = (unsigned*)indexBufferData.data();
-    for (int i = 0; i < indexVectorSize; i++) {
-        indices[i] = unpackedIndices[i];
+namespace {
+    bool readTextureHeader(const assets::AssetFileView& file, MetadataSource& source,
+                           assets::TextureMetadata& metadata, Texture& texture) {
+        if (!source.read(file, "TEXI") || !assets::readTextureMetadata(source.metadata, file.blobSize, metadata)) {
+            return false;
+        }
+
+        const assets::TextureHeader& header = metadata.header;
+        texture.width = header.width;
+        texture.height = header.height;
+        texture.nrComponents = header.nrComponents;
+        texture.type = header.type;
+        texture.mipLevels = header.mipLevels;
+        texture.compression = (TextureCompression) header.format;
+        return true;
     }
+}
+
+bool AssetConverter::convertBinaryToTexture(const assets::AssetFileView& file, Texture& texture,
+                                            const assets::BlockCallback& onBlockDecoded) {
+    texture = {};
 
-    auto* unpackedVertices = (Vertex*)vertexBufferData.data();
-    for (int i = 0; i < vertexVectorSize; i++) {
-        vertices[i] = unpackedVertices[i];
+    MetadataSource source;
+    assets::TextureMetadata metadata{};
+    if (!readTextureHeader(file, source, metadata, texture)) {
+        std::cout << "Unknown or corrupted texture asset\n";
+        texture = {};
+        return false;
+    }
+    const assets::TextureHeader& header = metadata.header;
+
+    // Pixels are malloc'd since every other texture source hands out stb_image buffers, freed with free().
+    // The buffer is owned here until it is fully decoded, so errors and exceptions don't leak or leak out.
+    std::unique_ptr<unsigned char, decltype(&free)> data((unsigned char*) malloc(header.bufferSize), &free);
+    if (data == nullptr ||
+        !assets::decompressBlocks(file.binaryBlob, file.blobSize, metadata.blocks, header.blockCount, data.get(),
+                                  header.bufferSize, (assets::Codec) header.codec, header.blockSize, onBlockDecoded)) {
+        std::cout << "Texture asset is corrupted\n";
+        texture = {};
+        return false;
     }
 
-    mesh.indices = indices;
-    mesh.vertices = vertices;
+    texture.data = data.release();
+    return true;
+}
 
-    return mesh;
+bool AssetConverter::readTextureLevels(const assets::AssetFileView& file, int firstLevel, int lastLevel,
+                                       Texture& texture, std::vector<unsigned char>& levels) {
+    return readTextureLevels(file, firstLevel, lastLevel, texture, [&](size_t size) {
+        levels.resize(size);
+        return levels.data();
+    });
 }
 
-assets::AssetFile AssetConverter::convertTextureToBinary(Texture& texture) {
-    nlohmann::json textureMetadata;
-    textureMetadata["type"] = texture.type;
-    textureMetadata["format"] = "RGBA8";
-    textureMetadata["width"] = texture.width;
-    textureMetadata["height"] = texture.height;
-    textureMetadata["nrComponents"] = texture.nrComponents;
+bool AssetConverter::readTextureLevels(const assets::AssetFileView& file, int firstLevel, int lastLevel,
+                                       Texture& texture, unsigned char* destination, size_t capacity) {
+    return readTextureLevels(file, firstLevel, lastLevel, texture, [&](size_t size) {
+        return size <= capacity ? destination : nullptr;
+    });
+}
 
-    // TODO: Change this to account for other texture formats (Not everything will be 8 bits per channel)
-    int32_t textureBufferSize = texture.height * texture.width * texture.nrComponents;
-    textureMetadata["buffer_size"] = textureBufferSize;
+bool AssetConverter::readTextureLevels(const assets::AssetFileView& file, int firstLevel, int lastLevel,
+                                       Texture& texture, const std::function<unsigned char*(size_t)>& destinationFor) {
+    MetadataSource source;
+    assets::TextureMetadata metadata{};
+    if (!readTextureHeader(file, source, metadata, texture) ||
+        firstLevel < 0 || lastLevel > texture.mipLevels || firstLevel >= lastLevel) {
+        return false;
+    }
+    const assets::TextureHeader& header = metadata.header;
+
+    size_t offset = 0;
+    for (int level = 0; level < firstLevel; level++) {
+        offset += assets::textureLevelSize(texture, level);
+    }
+    size_t size = 0;
+    for (int level = firstLevel; level < lastLevel; level++) {
+        size += assets::textureLevelSize(texture, level);
+    }
 
+    unsigned char* destination = destinationFor(size);
+    if (destination == nullptr) {
+        return false;
+    }
+    return assets::decompressBlockRange(file.binaryBlob, file.blobSize, metadata.blocks, header.blockCount,
+        header.bufferSize, (assets::Codec) header.codec, header.blockSize, offset, size, destination);
+}
+
+namespace {
+    void appendFloats(std::vector<float>& data, const float* values, size_t count) {
+        data.insert(data.end(), values, values + count);
+    }
+
+    // Reads back what appendFloats wrote, failing instead of running past the end
+    struct FloatReader {
+        const std::vector<float>& data;
+        size_t position = 0;
+
+        bool read(float* values, size_t count) {
+            if (position + count > data.size()) return false;
+            memcpy(values, data.data() + position, count * sizeof(float));
+            position += count;
+            return true;
+        }
+    };
+}
+
+assets::AssetFile AssetConverter::convertSceneToBinary(const ModelScene& scene) {
     assets::AssetFile file;
-    file.type[0] = 'T';
-    file.type[1] = 'E';
-    file.type[2] = 'X';
-    file.type[3] = 'I';
-    file.version = 1;
+    setFileType(file, "SCNE");
 
-    int possibleCompressSize = LZ4_compressBound(textureBufferSize);
-    file.binaryBlob.resize(possibleCompressSize);
+    // Names and counts go in the metadata, transforms and keys in the blob
+    std::vector<float> data;
+    for (const NodeData& node : scene.nodes) {
+        appendFloats(data, &node.originalTransform[0][0], 16);
+    }
+    for (const glm::mat4& transform : scene.meshTransforms) {
+        appendFloats(data, &transform[0][0], 16);
+    }
+    for (const AnimationClip& clip : scene.clips) {
+        for (const NodeChannel& channel : clip.channels) {
+            for (const VectorKey& key : channel.positions) {
+                float values[4] = {key.time, key.value.x, key.value.y, key.value.z};
+                appendFloats(data, values, 4);
+            }
+            for (const RotationKey& key : channel.rotations) {
+                float values[5] = {key.time, key.value.x, key.value.y, key.value.z, key.value.w};
+                appendFloats(data, values, 5);
+            }
+            for (const VectorKey& key : channel.scales) {
+                float values[4] = {key.time, key.value.x, key.value.y, key.value.z};
+                appendFloats(data, values, 4);
+            }
+        }
+    }
 
-    int compressedSize = LZ4_compress_default((const char*)texture.data, file.binaryBlob.data(), textureBufferSize, possibleCompressSize);
-    file.binaryBlob.resize(compressedSize);
+    assets::SceneHeader header{};
+    header.nodeCount = scene.nodes.size();
+    header.materialCount = scene.materialTextures.size();
+    header.meshCount = scene.meshMaterials.size();
+    header.clipCount = scene.clips.size();
+
+    size_t bufferSize = data.size() * sizeof(float);
+    header.bufferSize = bufferSize;
+    const assets::CodecSettings& settings = codecs.scene;
+    header.codec = (uint32_t) settings.codec;
+    header.blockSize = assets::BLOCK_SIZE;
+    auto blocks = assets::compressBlocks(file.binaryBlob, data.data(), bufferSize, settings);
+    header.blockCount = blocks.size();
+
+    assets::MetadataWriter writer;
+    writer.write(header);
+    writer.writeArray(blocks.data(), blocks.size());
+    for (const NodeData& node : scene.nodes) {
+        writer.write((int32_t) node.parentIndex);
+        writer.writeString(node.name);
+    }
+    for (const std::vector<std::string>& textures : scene.materialTextures) {
+        writer.write((uint32_t) textures.size());
+        for (const std::string& texture : textures) writer.writeString(texture);
+    }
+    writer.writeArray(scene.meshMaterials.data(), scene.meshMaterials.size());
+    for (const AnimationClip& clip : scene.clips) {
+        writer.writeString(clip.name);
+        writer.write(clip.duration);
+        writer.write(clip.ticksPerSecond);
+        writer.write((uint32_t) clip.channels.size());
+        for (const NodeChannel& channel : clip.channels) {
+            writer.writeString(channel.nodeName);
+            uint32_t keyCounts[3] = {(uint32_t) channel.positions.size(), (uint32_t) channel.rotations.size(),
+                                     (uint32_t) channel.scales.size()};
+            writer.write(keyCounts);
+        }
+    }
 
-    textureMetadata["compression"] = "LZ4";
-    file.json = textureMetadata.dump();
+    file.metadata = std::move(writer.data);
+    setCodec(file, settings);
+    file.rawBlobSize = bufferSize;
 
     return file;
 }
 
-Texture AssetConverter::convertBinaryToTexture(const std::string& path) {
+bool AssetConverter::convertBinaryToScene(const assets::AssetFileView& file, ModelScene& scene) {
+    if (!assets::hasBinaryMetadata(file, "SCNE")) {
+        std::cout << "Unknown scene asset\n";
+        return false;
+    }
+
+    assets::SceneMetadata sceneMetadata{};
+    if (!assets::readSceneMetadata(file.metadata, file.blobSize, sceneMetadata)) {
+        std::cout << "Scene asset is corrupted\n";
+        return false;
+    }
+    const assets::SceneHeader& header = sceneMetadata.header;
+
+    std::vector<float> data(header.bufferSize / sizeof(float));
+    if (!assets::decompressBlocks(file.binaryBlob, file.blobSize, sceneMetadata.blocks, header.blockCount, data.data(),
+                                  data.size() * sizeof(float), (assets::Codec) header.codec, header.blockSize)) {
+        std::cout << "Scene asset is corrupted\n";
+        return false;
+    }
+    assets::MetadataReader metadata(sceneMetadata.tables);
+    FloatReader reader{data};
+    bool success = true;
+
+    std::string_view name;
+    scene.nodes.resize(header.nodeCount);
+    for (NodeData& node : scene.nodes) {
+        int32_t parent = -1;
+        metadata.read(parent);
+        metadata.readString(name);
+        node.name = name;
+        node.parentIndex = parent;
+        success = reader.read(&node.originalTransform[0][0], 16) && success;
+        node.transformation = node.originalTransform;
+    }
+
+    scene.materialTextures.resize(header.materialCount);
+    for (std::vector<std::string>& textures : scene.materialTextures) {
+        uint32_t textureCount = 0;
+        metadata.read(textureCount);
+        for (uint32_t i = 0; i < textureCount && metadata.readString(name); i++) {
+            textures.emplace_back(name);
+        }
+    }
+
+    const uint32_t* meshMaterials = metadata.readArray<uint32_t>(header.meshCount);
+    if (meshMaterials != nullptr) {
+        scene.meshMaterials.assign(meshMaterials, meshMaterials + header.meshCount);
+    }
+    scene.meshTransforms.resize(header.meshCount);
+    for (glm::mat4& transform : scene.meshTransforms) {
+        success = reader.read(&transform[0][0], 16) && success;
+    }
+
+    scene.clips.resize(header.clipCount);
+    for (AnimationClip& clip : scene.clips) {
+        uint32_t channelCount = 0;
+        metadata.readString(name);
+        clip.name = name;
+        metadata.read(clip.duration);
+        metadata.read(clip.ticksPerSecond);
+        metadata.read(channelCount);
+
+        for (uint32_t i = 0; i < channelCount && metadata.ok(); i++) {
+            NodeChannel channel;
+            uint32_t keyCounts[3] = {};
+            metadata.readString(name);
+            metadata.read(keyCounts);
+            channel.nodeName = name;
+            // Every key takes at least four floats, larger counts can't be in the rest of the blob
+            if (keyCounts[0] + (size_t) keyCounts[1] + keyCounts[2] > (data.size() - reader.position) / 4) {
+                success = false;
+                break;
+            }
+            channel.positions.resize(keyCounts[0]);
+            channel.rotations.resize(keyCounts[1]);
+            channel.scales.resize(keyCounts[2]);
+
+            float values[5];
+            for (VectorKey& key : channel.positions) {
+                success = reader.read(values, 4) && success;
+                key = {values[0], glm::vec3(values[1], values[2], values[3])};
+            }
+            for (RotationKey& key : channel.rotations) {
+                success = reader.read(values, 5) && success;
+                key = {values[0], glm::quat(values[4], values[1], values[2], values[3])};
+            }
+            for (VectorKey& key : channel.scales) {
+                success = reader.read(values, 4) && success;
+                key = {values[0], glm::vec3(values[1], values[2], values[3])};
+            }
+            clip.channels.push_back(std::move(channel));
+        }
+    }
+
+    if (!success || !metadata.ok() || reader.position != data.size()) {
+        std::cout << "Scene asset is corrupted\n";
+        return false;
+    }
+    return true;
+}
+
+assets::AssetFile AssetConverter::convertSkinToBinary(const Animation& animation) {
     assets::AssetFile file;
-    loadBinaryFile(path, file);
+    setFileType(file, "SKIN");
+
+    std::vector<std::string> boneNames(animation.bone_info.size());
+    for (const auto& [name, index] : animation.boneName_To_Index) {
+        if (index < boneNames.size()) boneNames[index] = name;
+    }
 
-    auto metadata = nlohmann::json::parse(file.json);
+    // Offset matrices followed by the per vertex weights, the layout the SSBO takes them in
+    size_t offsetsSize = animation.bone_info.size() * sizeof(glm::mat4);
+    size_t weightsSize = animation.bone_data.size() * sizeof(VertexBoneData);
+    std::vector<char> data(offsetsSize + weightsSize);
+    for (size_t i = 0; i < animation.bone_info.size(); i++) {
+        memcpy(data.data() + i * sizeof(glm::mat4), &animation.bone_info[i].offsetTransform[0][0], sizeof(glm::mat4));
+    }
+    if (weightsSize > 0) {
+        memcpy(data.data() + offsetsSize, animation.bone_data.data(), weightsSize);
+    }
 
-    Texture texture;
-    texture.height = metadata["height"];
-    texture.width = metadata["width"];
-    texture.nrComponents = metadata["nrComponents"];
-    texture.type = metadata["type"].get<std::string>();
+    assets::SkinHeader header{};
+    header.boneCount = boneNames.size();
+    header.vertexCount = animation.bone_data.size();
+    header.bufferSize = data.size();
+    const assets::CodecSettings& settings = codecs.mesh;
+    header.codec = (uint32_t) settings.codec;
+    header.blockSize = assets::BLOCK_SIZE;
+    auto blocks = assets::compressBlocks(file.binaryBlob, data.data(), data.size(), settings);
+    header.blockCount = blocks.size();
+
+    assets::MetadataWriter writer;
+    writer.write(header);
+    writer.writeArray(blocks.data(), blocks.size());
+    for (const std::string& name : boneNames) {
+        writer.writeString(name);
+    }
 
-    int textureBufferSize = metadata["buffer_size"];
-    // TODO: Fix this to not use malloc because it doesn't account for exceptions and errors
-    texture.data = (unsigned char*)malloc(textureBufferSize);
-    LZ4_decompress_safe(file.binaryBlob.data(), (char*)texture.data, file.binaryBlob.size(), textureBufferSize);
+    file.metadata = std::move(writer.data);
+    setCodec(file, settings);
+    file.rawBlobSize = data.size();
 
-    return texture;
+    return file;
+}
+
+bool AssetConverter::convertBinaryToSkin(const assets::AssetFileView& file, Animation& animation) {
+    if (!assets::hasBinaryMetadata(file, "SKIN")) {
+        std::cout << "Unknown skin asset\n";
+        return false;
+    }
+
+    assets::SkinMetadata skinMetadata{};
+    if (!assets::readSkinMetadata(file.metadata, file.blobSize, skinMetadata)) {
+        std::cout << "Skin asset is corrupted\n";
+        return false;
+    }
+    const assets::SkinHeader& header = skinMetadata.header;
+    size_t offsetsSize = header.boneCount * sizeof(glm::mat4);
+    size_t weightsSize = header.vertexCount * sizeof(VertexBoneData);
+
+    std::vector<char> data(header.bufferSize);
+    if (!assets::decompressBlocks(file.binaryBlob, file.blobSize, skinMetadata.blocks, header.blockCount, data.data(),
+                                  data.size(), (assets::Codec) header.codec, header.blockSize)) {
+        std::cout << "Skin asset is corrupted\n";
+        return false;
+    }
+    assets::MetadataReader metadata(skinMetadata.boneNames);
+
+    animation.bone_info.resize(header.boneCount);
+    for (uint32_t i = 0; i < header.boneCount; i++) {
+        std::string_view name;
+        metadata.readString(name);
+        memcpy(&animation.bone_info[i].offsetTransform[0][0], data.data() + i * sizeof(glm::mat4), sizeof(glm::mat4));
+        animation.boneName_To_Index[std::string(name)] = i;
+    }
+    animation.bone_data.resize(header.vertexCount);
+    if (weightsSize > 0) {
+        memcpy(animation.bone_data.data(), data.data() + offsetsSize, weightsSize);
+    }
+    return metadata.ok();
+}
+
+namespace {
+    void writeSource(assets::MetadataWriter& writer, const assets::SourceFile& source) {
+        writer.write(assets::SourceRecord{source.size, source.modifiedTime, source.hash});
+        writer.writeString(source.path);
+    }
+
+    bool readSource(assets::MetadataReader& reader, assets::SourceFile& source) {
+        assets::SourceRecord record{};
+        std::string_view path;
+        if (!reader.read(record) || !reader.readString(path)) return false;
+
+        source.path = path;
+        source.size = record.size;
+        source.modifiedTime = record.modifiedTime;
+        source.hash = record.hash;
+        return true;
+    }
 }
 
 assets::AssetFile AssetConverter::convertModelAssetInfoToBinary(ModelAssetInfo& assetInfo) {
-    nlohmann::json model_metadata;
-    model_metadata["numMeshes"] = assetInfo.numMeshes;
-    model_metadata["numTextures"] = assetInfo.numTexture;
+    assets::InfoHeader header{};
+    header.meshCount = assetInfo.numMeshes;
+    header.textureCount = assetInfo.numTexture;
+    header.importerFlags = assetInfo.importerFlags;
+    header.converterVersion = assetInfo.converterVersion;
+    header.sourceCount = assetInfo.sources.size();
+    header.textureSourceCount = assetInfo.textures.size();
+
+    assets::MetadataWriter writer;
+    writer.write(header);
+    for (const assets::SourceFile& source : assetInfo.sources) {
+        writeSource(writer, source);
+    }
+    for (const TextureSource& texture : assetInfo.textures) {
+        writer.writeString(texture.path);
+        writer.writeString(texture.type);
+        writeSource(writer, texture.file);
+    }
 
     assets::AssetFile file;
-    file.type[0] = 'I';
-    file.type[1] = 'N';
-    file.type[2] = 'F';
-    file.type[3] = 'O';
-
-    file.version = 1;
-    file.json = model_metadata.dump();
+    setFileType(file, "INFO");
+    file.metadata = std::move(writer.data);
 
     return file;
 }
 
 ModelAssetInfo AssetConverter::convertBinaryToModelAssetInfo(const std::string& path) {
-    assets::AssetFile file;
-    assets::loadBinaryFile(path, file);
+    assets::MappedFile mapping;
+    assets::AssetFileView file;
+    if (!assets::mapBinaryFile(path, mapping, file)) {
+        return {};
+    }
 
-    nlohmann::json model_metadata = nlohmann::json::parse(file.json);
+    return convertBinaryToModelAssetInfo(file);
+}
 
+ModelAssetInfo AssetConverter::convertBinaryToModelAssetInfo(const assets::AssetFileView& file) {
     ModelAssetInfo info;
-    info.numMeshes = model_metadata["numMeshes"];
-    info.numTexture = model_metadata["numTextures"];
 
+    // Infos written before source tracking come back with converterVersion 0 and are treated as stale
+    MetadataSource source;
+    if (!source.read(file, "INFO")) {
+        std::cout << "Unknown model info asset\n";
+        return info;
+    }
+
+    assets::MetadataReader reader(source.metadata);
+    assets::InfoHeader header{};
+    if (!reader.read(header)) {
+        return info;
+    }
+    info.numMeshes = header.meshCount;
+    info.numTexture = header.textureCount;
+    info.importerFlags = header.importerFlags;
+    info.converterVersion = header.converterVersion;
+
+    // Counts aren't trusted for allocations, a record is only added once it has been read
+    for (uint32_t i = 0; i < header.sourceCount && reader.ok(); i++) {
+        assets::SourceFile sourceFile;
+        if (readSource(reader, sourceFile)) info.sources.push_back(std::move(sourceFile));
+    }
+    for (uint32_t i = 0; i < header.textureSourceCount && reader.ok(); i++) {
+        TextureSource texture;
+        std::string_view path, type;
+        reader.readString(path);
+        reader.readString(type);
+        texture.path = path;
+        texture.type = type;
+        if (readSource(reader, texture.file)) info.textures.push_back(std::move(texture));
+    }
+
+    // A truncated info can't be trusted to describe the pack
+    if (!reader.ok()) {
+        std::cout << "Model info asset is corrupted\n";
+        info.converterVersion = 0;
+    }
     return info;
 }
+
+bool AssetConverter::packAssetFolder(const std::string& folderPath, const std::string& packPath) {
+    // Folders from older builds carry json, which is converted to binary headers on the way into the pack
+    auto loadAsset = [](const std::string& path, const char (&type)[5], assets::AssetFile& file) {
+        assets::MappedFile mapping;
+        assets::AssetFileView view;
+        MetadataSource source;
+        if (!assets::mapBinaryFile(path, mapping, view) || !source.read(view, type)) {
+            return false;
+        }
+
+        setFileType(file, type);
+        file.metadata = std::string(source.metadata);
+        file.binaryBlob.assign(view.binaryBlob, view.binaryBlob + view.blobSize);
+        return true;
+    };
+
+    assets::AssetFile infoFile;
+    assets::InfoHeader info{};
+    if (!loadAsset(folderPath + "/main.object", "INFO", infoFile) ||
+        !assets::MetadataReader(infoFile.metadata).read(info)) {
+        std::cout << "No main.object found in " << folderPath << "\n";
+        return false;
+    }
+
+    assets::PackWriter writer;
+    if (!writer.open(packPath)) {
+        std::cout << "Could not create pack file " << packPath << "\n";
+        return false;
+    }
+
+    bool success = writer.add(assets::PackEntryType::Info, 0, infoFile);
+
+    auto addEntry = [&](assets::PackEntryType type, int index, const std::string& path) {
+        assets::AssetFile file;
+        bool isMesh = type == assets::PackEntryType::Mesh;
+        if (!loadAsset(path, isMesh ? "MESH" : "TEXI", file)) {
+            std::cout << "Missing or unreadable asset file " << path << "\n";
+            return false;
+        }
+
+        uint32_t codec;
+        if (isMesh) {
+            assets::MeshMetadata metadata{};
+            if (!assets::readMeshMetadata(file.metadata, file.binaryBlob.size(), metadata)) return false;
+            codec = metadata.header.codec;
+            file.rawBlobSize = metadata.header.vertexBufferSize + metadata.header.indexBufferSize +
+                               metadata.header.meshletCount * sizeof(Meshlet);
+        }
+        else {
+            assets::TextureMetadata metadata{};
+            if (!assets::readTextureMetadata(file.metadata, file.binaryBlob.size(), metadata)) return false;
+            codec = metadata.header.codec;
+            file.rawBlobSize = metadata.header.bufferSize;
+        }
+        file.codec = (assets::Codec) codec;
+
+        return writer.add(type, index, file);
+    };
+
+    for (uint32_t i = 0; i < info.meshCount && success; i++) {
+        std::string path = folderPath + "/meshes/mesh" + std::to_string(i) + ".object";
+        success = addEntry(assets::PackEntryType::Mesh, i, path);
+    }
+    for (uint32_t i = 0; i < info.textureCount && success; i++) {
+        std::string path = folderPath + "/textures/texture" + std::to_string(i) + ".object";
+        success = addEntry(assets::PackEntryType::Texture, i, path);
+    }
+
+    return writer.finish() && success;
+}
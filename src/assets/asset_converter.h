@@ -4,24 +4,119 @@
 
 #ifndef ASSET_CONVERTER_H
 #define ASSET_CONVERTER_H
+#include <functional>
+
+#include "asset_cache.h"
 #include "asset_file.h"
+#include "asset_pack.h"
+#include "block_codec.h"
+#include "texture_compression.h"
+#include "texture_mips.h"
+#include "assets/animation.h"
 #include "assets/mesh.h"
 
+// Image a texture entry was decoded from, keyed by the path materials refer to it with
+struct TextureSource {
+    std::string path;
+    std::string type;
+    assets::SourceFile file;
+};
+
 struct ModelAssetInfo {
     int numMeshes = 0;
     int numTexture = 0;
+
+    // Inputs the pack was built from. Meshes are stale once any of these differ.
+    uint32_t importerFlags = 0;
+    uint32_t converterVersion = 0;
+    std::vector<assets::SourceFile> sources;
+    // One per texture entry, in entry order
+    std::vector<TextureSource> textures;
+};
+
+// Everything of a model besides mesh and texture payloads, enough to draw and animate it without the importer
+struct ModelScene {
+    std::vector<NodeData> nodes;
+    // Texture paths of each material, as in textures_loaded
+    std::vector<std::vector<std::string>> materialTextures;
+    // Per mesh, in mesh order
+    std::vector<uint32_t> meshMaterials;
+    std::vector<glm::mat4> meshTransforms;
+    std::vector<AnimationClip> clips;
+};
+
+// Codec each kind of blob is baked with, see assets::codecRegistry
+struct BlobCodecs {
+    // Meshes and the skins that go with them
+    assets::CodecSettings mesh;
+    assets::CodecSettings texture;
+    assets::CodecSettings scene;
+
+    assets::CodecSettings forEntry(assets::PackEntryType type) const;
 };
 
 class AssetConverter {
 public:
-     assets::AssetFile convertMeshToBinary(Mesh&mesh);
-    Mesh convertBinaryToMesh(const std::string&path);
+    // Bump whenever the bytes written for the same input change, so cached packs get rebuilt
+    static constexpr uint32_t VERSION = 11;
+
+    // Codec::None blobs are larger on disk and only copied out on load,
+    // LZ4HC makes smaller packs that decode as fast as LZ4 at the cost of bake time
+    BlobCodecs codecs;
+    // Stores meshes as assets::PackedVertex when their attributes fit, see chooseVertexFormat
+    bool quantizeVertices = true;
+    // Bake-time welding and vertex cache/fetch reordering, see assets::optimizeMesh
+    bool optimizeMeshes = true;
+    bool reorderForOverdraw = true;
+    // Stores 16 bit indices for meshes with at most 65536 vertices
+    bool narrowIndices = true;
+    // Appends simplified index buffers for distant draws, see assets::generateLods
+    bool generateLods = true;
+    // Splits meshes into separately culled clusters, see assets::buildMeshlets
+    bool generateMeshlets = true;
+    // Stores the whole mip chain with textures so nothing is filtered at load time
+    bool generateMips = true;
+    assets::MipFilter mipFilter = assets::MipFilter::Kaiser;
+    // Block compresses textures in a format picked from their role, see assets::chooseTextureCompression
+    bool compressTextures = true;
+
+    assets::AssetFile convertMeshToBinary(Mesh&mesh);
+    // False for unreadable or corrupted assets, which leave mesh empty rather than partly decoded
+    bool convertBinaryToMesh(const std::string& path, Mesh& mesh);
+    // onBlockDecoded reports byte ranges of [vertices | indices] as they are decoded, possibly from several threads
+    bool convertBinaryToMesh(const assets::AssetFileView& file, Mesh& mesh,
+                             const assets::BlockCallback& onBlockDecoded = nullptr);
 
     assets::AssetFile convertTextureToBinary(Texture&texture);
-    Texture convertBinaryToTexture(const std::string&path);
+    // Same for textures, texture.data is only set when the whole image decoded
+    bool convertBinaryToTexture(const std::string& path, Texture& texture);
+    bool convertBinaryToTexture(const assets::AssetFileView& file, Texture& texture,
+                                const assets::BlockCallback& onBlockDecoded = nullptr);
+    // Fills texture's size and format from the asset and decodes only mip levels [firstLevel, lastLevel)
+    // into levels, without touching texture.data
+    bool readTextureLevels(const assets::AssetFileView& file, int firstLevel, int lastLevel, Texture& texture,
+                           std::vector<unsigned char>& levels);
+    // Same, decoding straight into destination, which has to hold at least `capacity` bytes
+    bool readTextureLevels(const assets::AssetFileView& file, int firstLevel, int lastLevel, Texture& texture,
+                           unsigned char* destination, size_t capacity);
+
+    assets::AssetFile convertSceneToBinary(const ModelScene& scene);
+    bool convertBinaryToScene(const assets::AssetFileView& file, ModelScene& scene);
+
+    // Only the bone weights, offsets and names of animation, its SSBO is left out
+    assets::AssetFile convertSkinToBinary(const Animation& animation);
+    bool convertBinaryToSkin(const assets::AssetFileView& file, Animation& animation);
 
     assets::AssetFile convertModelAssetInfoToBinary(ModelAssetInfo& assetInfo);
     ModelAssetInfo convertBinaryToModelAssetInfo(const std::string& path);
+    ModelAssetInfo convertBinaryToModelAssetInfo(const assets::AssetFileView& file);
+
+    // Repacks a folder of main/meshN/textureN .object files into a single pack file
+    bool packAssetFolder(const std::string& folderPath, const std::string& packPath);
+
+private:
+    bool readTextureLevels(const assets::AssetFileView& file, int firstLevel, int lastLevel, Texture& texture,
+                           const std::function<unsigned char*(size_t)>& destinationFor);
 };
 
 
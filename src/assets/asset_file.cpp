@@ -3,30 +3,185 @@
 //
 
 #include "asset_file.h"
+#include <algorithm>
 #include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // type + version + metadata length + blob size
+    constexpr size_t HEADER_SIZE = 4 + 3 * sizeof(uint32_t);
+}
 
-bool assets::saveBinaryFile(const std::string& path, const AssetFile& file) {
-    std::ofstream outputFile;
-    outputFile.open(path, std::ios::binary | std::ios::out);
+assets::MappedFile::~MappedFile() {
+    close();
+}
+
+assets::MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+assets::MappedFile& assets::MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+
+        mappedData = other.mappedData;
+        mappedSize = other.mappedSize;
+        other.mappedData = nullptr;
+        other.mappedSize = 0;
+#ifdef _WIN32
+        fileHandle = other.fileHandle;
+        mappingHandle = other.mappingHandle;
+        other.fileHandle = nullptr;
+        other.mappingHandle = nullptr;
+#endif
+    }
+
+    return *this;
+}
+
+bool assets::MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
 
-    outputFile.write(file.type, 4);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    mappedData = static_cast<const char*>(view);
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStats{};
+    if (fstat(fd, &fileStats) != 0 || fileStats.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, fileStats.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    madvise(view, fileStats.st_size, MADV_WILLNEED);
+
+    mappedData = static_cast<const char*>(view);
+    mappedSize = static_cast<size_t>(fileStats.st_size);
+#endif
+
+    return true;
+}
+
+void assets::MappedFile::close() {
+    if (mappedData == nullptr) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mappedData);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    munmap(const_cast<char*>(mappedData), mappedSize);
+#endif
+
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+void assets::MappedFile::prefetch(size_t offset, size_t size) const {
+    if (mappedData == nullptr || offset >= mappedSize) return;
+    size = std::min(size, mappedSize - offset);
+
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<char*>(mappedData + offset);
+    range.NumberOfBytes = size;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // madvise needs a page aligned start
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t alignedOffset = offset / pageSize * pageSize;
+    madvise(const_cast<char*>(mappedData + alignedOffset), size + (offset - alignedOffset), MADV_WILLNEED);
+#endif
+}
+
+bool assets::writeBinaryFile(std::ostream& output, const AssetFile& file) {
+    output.write(file.type, 4);
 
     const uint32_t version = file.version;
-    outputFile.write((const char*) &version, sizeof(uint32_t));
+    output.write((const char*) &version, sizeof(uint32_t));
 
-    const uint32_t length = file.json.size();
-    outputFile.write((const char*) &length, sizeof(uint32_t));
+    size_t paddedLength = HEADER_SIZE + file.metadata.size();
+    paddedLength = (paddedLength + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT - HEADER_SIZE;
+    const uint32_t length = paddedLength;
+    output.write((const char*) &length, sizeof(uint32_t));
 
     const uint32_t blobSize = file.binaryBlob.size();
-    outputFile.write((const char*) &blobSize, sizeof(uint32_t));
+    output.write((const char*) &blobSize, sizeof(uint32_t));
 
-    outputFile.write(file.json.c_str(), length);
+    // Binary headers ignore what follows their tables, json needs trailing whitespace
+    output.write(file.metadata.c_str(), file.metadata.size());
+    const std::string padding(paddedLength - file.metadata.size(), file.version < BINARY_METADATA_VERSION ? ' ' : '\0');
+    output.write(padding.c_str(), padding.size());
 
-    outputFile.write(file.binaryBlob.data(), blobSize);
+    output.write(file.binaryBlob.data(), blobSize);
+
+    return !output.fail();
+}
 
+bool assets::saveBinaryFile(const std::string& path, const AssetFile& file) {
+    std::ofstream outputFile;
+    outputFile.open(path, std::ios::binary | std::ios::out);
+
+    if (!outputFile.is_open()) {
+        return false;
+    }
+
+    writeBinaryFile(outputFile, file);
     outputFile.close();
 
-    return true;
+    return !outputFile.fail();
 }
 
 bool assets::loadBinaryFile(const std::string& path, AssetFile& file) {
@@ -42,16 +197,47 @@ bool assets::loadBinaryFile(const std::string& path, AssetFile& file) {
     inputFile.read(file.type, 4);
     inputFile.read((char*) &file.version, sizeof(uint32_t));
 
-    uint32_t jsonLength = 0;
-    inputFile.read((char*) &jsonLength, sizeof(uint32_t));
+    uint32_t metadataLength = 0;
+    inputFile.read((char*) &metadataLength, sizeof(uint32_t));
     uint32_t blobSize = 0;
     inputFile.read((char*) &blobSize, sizeof(uint32_t));
 
-    file.json.resize(jsonLength);
-    inputFile.read(file.json.data(), jsonLength);
+    file.metadata.resize(metadataLength);
+    inputFile.read(file.metadata.data(), metadataLength);
 
     file.binaryBlob.resize(blobSize);
     inputFile.read(file.binaryBlob.data(), blobSize);
 
     return true;
 }
+
+bool assets::parseBinaryFile(const char* data, size_t size, AssetFileView& view) {
+    if (data == nullptr || size < HEADER_SIZE) {
+        return false;
+    }
+
+    uint32_t version = 0, metadataLength = 0, blobSize = 0;
+    memcpy(view.type, data, 4);
+    memcpy(&version, data + 4, sizeof(uint32_t));
+    memcpy(&metadataLength, data + 8, sizeof(uint32_t));
+    memcpy(&blobSize, data + 12, sizeof(uint32_t));
+
+    if (HEADER_SIZE + (size_t) metadataLength + blobSize > size) {
+        return false;
+    }
+
+    view.version = (int) version;
+    view.metadata = std::string_view(data + HEADER_SIZE, metadataLength);
+    view.binaryBlob = data + HEADER_SIZE + metadataLength;
+    view.blobSize = blobSize;
+
+    return true;
+}
+
+bool assets::mapBinaryFile(const std::string& path, MappedFile& mapping, AssetFileView& view) {
+    if (!mapping.open(path)) {
+        return false;
+    }
+
+    return parseBinaryFile(mapping.data(), mapping.size(), view);
+}
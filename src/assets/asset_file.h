@@ -4,18 +4,82 @@
 
 #pragma once
 
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace assets {
 
+// The metadata is padded so the blob starts on this boundary inside the file
+constexpr size_t BLOB_ALIGNMENT = 16;
+
+// Assets from this version on carry binary headers as metadata, see asset_metadata.h. Earlier ones carry json.
+constexpr int BINARY_METADATA_VERSION = 2;
+
+// How the blocks of a blob are compressed, see assets::codecRegistry
+enum class Codec : uint32_t {
+    None = 0,
+    LZ4 = 1,
+    LZ4HC = 2
+};
+
 struct AssetFile {
     char type[4];
     int version;
-    std::string json;
+    std::string metadata;
     std::vector<char> binaryBlob;
+
+    // Not written to .object files, only recorded in pack tables of contents
+    Codec codec = Codec::None;
+    uint32_t codecLevel = 0;
+    uint64_t rawBlobSize = 0;
+};
+
+// Read-only memory mapping of a whole file. The mapping is released on destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    // Asks the OS to start reading a range in the background so later accesses don't block on IO
+    void prefetch(size_t offset, size_t size) const;
+
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
 };
 
+// Non-owning view of an asset file. Points into the memory it was parsed from.
+struct AssetFileView {
+    char type[4];
+    int version;
+    std::string_view metadata;
+    const char* binaryBlob = nullptr;
+    size_t blobSize = 0;
+};
+
+bool writeBinaryFile(std::ostream& output, const AssetFile& file);
 bool saveBinaryFile(const std::string& path, const AssetFile& file);
 bool loadBinaryFile(const std::string& path, AssetFile& file);
-}
\ No newline at end of file
+
+bool parseBinaryFile(const char* data, size_t size, AssetFileView& view);
+bool mapBinaryFile(const std::string& path, MappedFile& mapping, AssetFileView& view);
+}
@@ -0,0 +1,386 @@
+#include "asset_json.h"
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "asset_metadata.h"
+#include "block_codec.h"
+#include "mesh.h"
+#include "texture_compression.h"
+#include "vertex_format.h"
+
+namespace {
+    // Assets from before block compression stored each stream as one block
+    std::vector<uint32_t> singleBlock(size_t rawSize, size_t storedSize) {
+        if (rawSize == 0) return {};
+        return {(uint32_t) storedSize};
+    }
+
+    uint32_t legacyCodec(const nlohmann::json& metadata) {
+        bool compressed = metadata["compression"].get<std::string>() != "none";
+        return (uint32_t) (compressed ? assets::Codec::LZ4 : assets::Codec::None);
+    }
+
+    bool upgradeMesh(const nlohmann::json& metadata, std::string& upgraded) {
+        assets::MeshHeader header{};
+        assets::VertexFormat vertexFormat = assets::VertexFormat::Float32;
+        if (metadata.contains("vertex_format") &&
+            !assets::vertexFormatFromName(metadata["vertex_format"].get<std::string>(), vertexFormat)) {
+            return false;
+        }
+        header.vertexFormat = (uint32_t) vertexFormat;
+        bool shortIndices = metadata.contains("index_format") && metadata["index_format"].get<std::string>() == "U16";
+        header.indexType = (uint32_t) (shortIndices ? assets::IndexType::UInt16 : assets::IndexType::UInt32);
+        header.vertexBufferSize = metadata["vertex_buffer_size"];
+        header.indexBufferSize = metadata["indices_buffer_size"];
+        header.codec = legacyCodec(metadata);
+
+        auto bounds = metadata["bounds"].get<std::vector<float>>();
+        if (bounds.size() != 8) return false;
+        std::copy(bounds.begin(), bounds.begin() + 4, header.boundsMax);
+        std::copy(bounds.begin() + 4, bounds.end(), header.boundsMin);
+
+        std::vector<MeshLod> lods;
+        if (metadata.contains("lods")) {
+            for (const nlohmann::json& lod : metadata["lods"]) {
+                lods.push_back({lod["offset"].get<uint32_t>(), lod["count"].get<uint32_t>(), lod["error"].get<float>()});
+            }
+        }
+
+        std::vector<uint32_t> vertexBlocks, indexBlocks, meshletBlocks;
+        if (metadata.contains("block_size")) {
+            header.blockSize = metadata["block_size"];
+            vertexBlocks = metadata["vertex_blocks"].get<std::vector<uint32_t>>();
+            indexBlocks = metadata["indices_blocks"].get<std::vector<uint32_t>>();
+            if (metadata.contains("meshlet_blocks")) {
+                header.meshletCount = metadata["meshlet_count"];
+                meshletBlocks = metadata["meshlet_blocks"].get<std::vector<uint32_t>>();
+            }
+        }
+        else if (metadata.contains("vertex_stored_size")) {
+            // One block per stream, large enough for either
+            header.blockSize = std::max<uint64_t>({header.vertexBufferSize, header.indexBufferSize, 1});
+            vertexBlocks = singleBlock(header.vertexBufferSize, metadata["vertex_stored_size"]);
+            indexBlocks = singleBlock(header.indexBufferSize, metadata["indices_stored_size"]);
+        }
+        else {
+            std::cout << "Mesh asset predates separate vertex and index streams, rebake it\n";
+            return false;
+        }
+
+        header.lodCount = lods.size();
+        header.vertexBlockCount = vertexBlocks.size();
+        header.indexBlockCount = indexBlocks.size();
+        header.meshletBlockCount = meshletBlocks.size();
+
+        assets::MetadataWriter writer;
+        writer.write(header);
+        writer.writeArray(lods.data(), lods.size());
+        writer.writeArray(vertexBlocks.data(), vertexBlocks.size());
+        writer.writeArray(indexBlocks.data(), indexBlocks.size());
+        writer.writeArray(meshletBlocks.data(), meshletBlocks.size());
+        upgraded = std::move(writer.data);
+        return true;
+    }
+
+    bool upgradeTexture(const nlohmann::json& metadata, size_t blobSize, std::string& upgraded) {
+        assets::TextureHeader header{};
+        std::string type = metadata["type"].get<std::string>();
+        if (type.size() >= sizeof(header.type)) return false;
+        memcpy(header.type, type.data(), type.size());
+
+        header.width = metadata["width"];
+        header.height = metadata["height"];
+        header.nrComponents = metadata["nrComponents"];
+        header.mipLevels = metadata.contains("mip_levels") ? metadata["mip_levels"].get<uint32_t>() : 1;
+
+        TextureCompression format = TextureCompression::None;
+        if (metadata.contains("format") &&
+            !assets::textureCompressionFromName(metadata["format"].get<std::string>(), format)) {
+            return false;
+        }
+        header.format = (uint32_t) format;
+        header.codec = legacyCodec(metadata);
+        header.bufferSize = metadata["buffer_size"];
+
+        std::vector<uint32_t> blocks;
+        if (metadata.contains("block_size")) {
+            header.blockSize = metadata["block_size"];
+            blocks = metadata["blocks"].get<std::vector<uint32_t>>();
+        }
+        else {
+            header.blockSize = std::max<uint64_t>(header.bufferSize, 1);
+            blocks = singleBlock(header.bufferSize, blobSize);
+        }
+        header.blockCount = blocks.size();
+
+        assets::MetadataWriter writer;
+        writer.write(header);
+        writer.writeArray(blocks.data(), blocks.size());
+        upgraded = std::move(writer.data);
+        return true;
+    }
+
+    void writeSource(assets::MetadataWriter& writer, const nlohmann::json& source) {
+        assets::SourceRecord record{};
+        record.size = source["size"];
+        record.modifiedTime = source["modified_time"];
+        record.hash = source["hash"];
+        writer.write(record);
+        writer.writeString(source["path"].get<std::string>());
+    }
+
+    bool upgradeInfo(const nlohmann::json& metadata, std::string& upgraded) {
+        assets::InfoHeader header{};
+        header.meshCount = metadata["numMeshes"];
+        header.textureCount = metadata["numTextures"];
+
+        // Packs written before source tracking have none of this and are treated as stale
+        bool tracked = metadata.contains("converter_version");
+        if (tracked) {
+            header.importerFlags = metadata["importer_flags"];
+            header.converterVersion = metadata["converter_version"];
+            header.sourceCount = metadata["sources"].size();
+            header.textureSourceCount = metadata["textures"].size();
+        }
+
+        assets::MetadataWriter writer;
+        writer.write(header);
+        if (tracked) {
+            for (const nlohmann::json& source : metadata["sources"]) {
+                writeSource(writer, source);
+            }
+            for (const nlohmann::json& texture : metadata["textures"]) {
+                writer.writeString(texture["path"].get<std::string>());
+                writer.writeString(texture["type"].get<std::string>());
+                writeSource(writer, texture["source"]);
+            }
+        }
+        upgraded = std::move(writer.data);
+        return true;
+    }
+
+    std::vector<uint32_t> tableToVector(const uint32_t* table, uint32_t count) {
+        return table != nullptr ? std::vector<uint32_t>(table, table + count) : std::vector<uint32_t>();
+    }
+
+    const char* codecName(uint32_t codec) {
+        const assets::CodecInfo* info = assets::findCodec((assets::Codec) codec);
+        return info != nullptr ? info->name : "unknown";
+    }
+
+    std::string readString(assets::MetadataReader& reader) {
+        std::string_view value;
+        reader.readString(value);
+        return std::string(value);
+    }
+
+    nlohmann::json sourceToJson(assets::MetadataReader& reader) {
+        assets::SourceRecord record{};
+        reader.read(record);
+
+        nlohmann::json source;
+        source["size"] = record.size;
+        source["modified_time"] = record.modifiedTime;
+        source["hash"] = record.hash;
+        source["path"] = readString(reader);
+        return source;
+    }
+}
+
+bool assets::readBinaryMetadata(const AssetFileView& file, const char (&type)[5], std::string& upgraded,
+                                std::string_view& metadata) {
+    if (memcmp(file.type, type, 4) != 0) {
+        return false;
+    }
+    if (file.version >= BINARY_METADATA_VERSION) {
+        metadata = file.metadata;
+        return file.version == BINARY_METADATA_VERSION;
+    }
+
+    nlohmann::json legacy = nlohmann::json::parse(file.metadata, nullptr, false);
+    if (legacy.is_discarded()) {
+        return false;
+    }
+
+    bool success = false;
+    if (memcmp(type, "MESH", 4) == 0) {
+        success = upgradeMesh(legacy, upgraded);
+    }
+    else if (memcmp(type, "TEXI", 4) == 0) {
+        success = upgradeTexture(legacy, file.blobSize, upgraded);
+    }
+    else if (memcmp(type, "INFO", 4) == 0) {
+        success = upgradeInfo(legacy, upgraded);
+    }
+
+    metadata = upgraded;
+    return success;
+}
+
+std::string assets::metadataToJson(const AssetFileView& file) {
+    std::string type(file.type, 4);
+    if (file.version < BINARY_METADATA_VERSION) {
+        return std::string(file.metadata);
+    }
+
+    nlohmann::json dump;
+    dump["type"] = type;
+    dump["version"] = file.version;
+    dump["blob_size"] = file.blobSize;
+
+    MetadataReader reader(file.metadata);
+    if (type == "MESH") {
+        MeshMetadata mesh{};
+        if (!readMeshMetadata(file.metadata, file.blobSize, mesh)) return "";
+        const MeshHeader& header = mesh.header;
+
+        dump["vertex_format"] = vertexFormatName((VertexFormat) header.vertexFormat);
+        dump["index_format"] = header.indexType == (uint32_t) IndexType::UInt16 ? "U16" : "U32";
+        dump["vertex_buffer_size"] = header.vertexBufferSize;
+        dump["indices_buffer_size"] = header.indexBufferSize;
+        dump["bounds_max"] = std::vector<float>(header.boundsMax, header.boundsMax + 4);
+        dump["bounds_min"] = std::vector<float>(header.boundsMin, header.boundsMin + 4);
+        dump["compression"] = codecName(header.codec);
+        dump["block_size"] = header.blockSize;
+        dump["vertex_blocks"] = tableToVector(mesh.vertexBlocks, header.vertexBlockCount);
+        dump["indices_blocks"] = tableToVector(mesh.indexBlocks, header.indexBlockCount);
+        dump["meshlet_count"] = header.meshletCount;
+        dump["meshlet_blocks"] = tableToVector(mesh.meshletBlocks, header.meshletBlockCount);
+
+        nlohmann::json lods = nlohmann::json::array();
+        for (uint32_t i = 0; i < header.lodCount; i++) {
+            nlohmann::json lod;
+            lod["offset"] = mesh.lods[i].indexOffset;
+            lod["count"] = mesh.lods[i].indexCount;
+            lod["error"] = mesh.lods[i].error;
+            lods.push_back(lod);
+        }
+        dump["lods"] = lods;
+    }
+    else if (type == "TEXI") {
+        TextureMetadata texture{};
+        if (!readTextureMetadata(file.metadata, file.blobSize, texture)) return "";
+        const TextureHeader& header = texture.header;
+
+        dump["texture_type"] = std::string(header.type);
+        dump["format"] = textureCompressionName((TextureCompression) header.format);
+        dump["width"] = header.width;
+        dump["height"] = header.height;
+        dump["nrComponents"] = header.nrComponents;
+        dump["mip_levels"] = header.mipLevels;
+        dump["buffer_size"] = header.bufferSize;
+        dump["compression"] = codecName(header.codec);
+        dump["block_size"] = header.blockSize;
+        dump["blocks"] = tableToVector(texture.blocks, header.blockCount);
+    }
+    else if (type == "SCNE") {
+        SceneHeader header{};
+        reader.read(header);
+        dump["buffer_size"] = header.bufferSize;
+        dump["compression"] = codecName(header.codec);
+        dump["block_size"] = header.blockSize;
+        dump["blocks"] = tableToVector(reader.readArray<uint32_t>(header.blockCount), header.blockCount);
+
+        nlohmann::json nodes = nlohmann::json::array();
+        for (uint32_t i = 0; i < header.nodeCount && reader.ok(); i++) {
+            int32_t parent = -1;
+            reader.read(parent);
+            nlohmann::json node;
+            node["parent"] = parent;
+            node["name"] = readString(reader);
+            nodes.push_back(node);
+        }
+        dump["nodes"] = nodes;
+
+        nlohmann::json materials = nlohmann::json::array();
+        for (uint32_t i = 0; i < header.materialCount && reader.ok(); i++) {
+            uint32_t textureCount = 0;
+            reader.read(textureCount);
+            nlohmann::json textures = nlohmann::json::array();
+            for (uint32_t j = 0; j < textureCount && reader.ok(); j++) {
+                textures.push_back(readString(reader));
+            }
+            materials.push_back(textures);
+        }
+        dump["materials"] = materials;
+
+        const uint32_t* meshMaterials = reader.readArray<uint32_t>(header.meshCount);
+        dump["mesh_materials"] = tableToVector(meshMaterials, header.meshCount);
+
+        nlohmann::json clips = nlohmann::json::array();
+        for (uint32_t i = 0; i < header.clipCount && reader.ok(); i++) {
+            nlohmann::json clip;
+            clip["name"] = readString(reader);
+            float duration = 0.0f, ticksPerSecond = 0.0f;
+            uint32_t channelCount = 0;
+            reader.read(duration);
+            reader.read(ticksPerSecond);
+            reader.read(channelCount);
+            clip["duration"] = duration;
+            clip["ticks_per_second"] = ticksPerSecond;
+
+            nlohmann::json channels = nlohmann::json::array();
+            for (uint32_t j = 0; j < channelCount && reader.ok(); j++) {
+                nlohmann::json channel;
+                channel["node"] = readString(reader);
+                uint32_t keyCounts[3] = {};
+                reader.read(keyCounts);
+                channel["positions"] = keyCounts[0];
+                channel["rotations"] = keyCounts[1];
+                channel["scales"] = keyCounts[2];
+                channels.push_back(channel);
+            }
+            clip["channels"] = channels;
+            clips.push_back(clip);
+        }
+        dump["clips"] = clips;
+    }
+    else if (type == "SKIN") {
+        SkinHeader header{};
+        reader.read(header);
+        dump["vertex_count"] = header.vertexCount;
+        dump["buffer_size"] = header.bufferSize;
+        dump["compression"] = codecName(header.codec);
+        dump["block_size"] = header.blockSize;
+        dump["blocks"] = tableToVector(reader.readArray<uint32_t>(header.blockCount), header.blockCount);
+
+        nlohmann::json bones = nlohmann::json::array();
+        for (uint32_t i = 0; i < header.boneCount && reader.ok(); i++) {
+            bones.push_back(readString(reader));
+        }
+        dump["bones"] = bones;
+    }
+    else if (type == "INFO") {
+        InfoHeader header{};
+        reader.read(header);
+        dump["numMeshes"] = header.meshCount;
+        dump["numTextures"] = header.textureCount;
+        dump["importer_flags"] = header.importerFlags;
+        dump["converter_version"] = header.converterVersion;
+
+        nlohmann::json sources = nlohmann::json::array();
+        for (uint32_t i = 0; i < header.sourceCount && reader.ok(); i++) {
+            sources.push_back(sourceToJson(reader));
+        }
+        dump["sources"] = sources;
+
+        nlohmann::json textures = nlohmann::json::array();
+        for (uint32_t i = 0; i < header.textureSourceCount && reader.ok(); i++) {
+            nlohmann::json texture;
+            texture["path"] = readString(reader);
+            texture["type"] = readString(reader);
+            texture["source"] = sourceToJson(reader);
+            textures.push_back(texture);
+        }
+        dump["textures"] = textures;
+    }
+
+    if (!reader.ok()) {
+        dump["error"] = "metadata is truncated";
+    }
+    return dump.dump(2);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "asset_file.h"
+
+namespace assets {
+
+// Binary metadata of file. Json metadata of assets from before BINARY_METADATA_VERSION is converted
+// into `upgraded`, which `metadata` then points into, so only those pay for parsing. False when the
+// asset isn't of `type` or its metadata can't be read.
+bool readBinaryMetadata(const AssetFileView& file, const char (&type)[5], std::string& upgraded,
+                        std::string_view& metadata);
+
+// Readable json of an asset's metadata for debugging, nothing reads it back
+std::string metadataToJson(const AssetFileView& file);
+}
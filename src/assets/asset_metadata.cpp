@@ -0,0 +1,154 @@
+#include "asset_metadata.h"
+
+#include "block_codec.h"
+#include "mesh.h"
+#include "texture_compression.h"
+#include "vertex_format.h"
+
+void assets::MetadataWriter::writeString(std::string_view value) {
+    uint32_t length = value.size();
+    write(length);
+    data.append(value.data(), value.size());
+    data.append((4 - value.size() % 4) % 4, '\0');
+}
+
+const char* assets::MetadataReader::take(size_t size, size_t alignment) {
+    const char* start = metadata.data() + position;
+    if (failed || size > metadata.size() - position || reinterpret_cast<uintptr_t>(start) % alignment != 0) {
+        failed = true;
+        return nullptr;
+    }
+    position += size;
+    return start;
+}
+
+bool assets::MetadataReader::readString(std::string_view& value) {
+    uint32_t length = 0;
+    if (!read(length)) return false;
+
+    size_t paddedLength = (size_t) length + (4 - length % 4) % 4;
+    const char* start = take(paddedLength, 1);
+    if (start == nullptr) return false;
+    value = std::string_view(start, length);
+    return true;
+}
+
+bool assets::hasBinaryMetadata(const AssetFileView& file, const char (&type)[5]) {
+    return memcmp(file.type, type, 4) == 0 && file.version == BINARY_METADATA_VERSION;
+}
+
+namespace {
+    // A run of `count` blocks holds exactly the bytes its size needs
+    bool isRunOf(uint64_t size, uint32_t count, uint32_t blockSize) {
+        return size <= (uint64_t) count * blockSize && (count == 0 || size > (uint64_t) (count - 1) * blockSize);
+    }
+
+    uint64_t storedSize(const uint32_t* blocks, uint32_t count) {
+        uint64_t size = 0;
+        for (uint32_t i = 0; i < count; i++) size += blocks[i];
+        return size;
+    }
+
+    // Stored blocks have to fit the blob and can't decode to more than the codec expands them to,
+    // which bounds every allocation made from a header by the size of the file
+    bool fitsBlob(uint32_t codec, uint64_t rawSize, uint64_t storedSize, size_t blobSize) {
+        const assets::CodecInfo* info = assets::findCodec((assets::Codec) codec);
+        return info != nullptr && storedSize <= blobSize && rawSize <= storedSize * info->maxRatio;
+    }
+}
+
+bool assets::readMeshMetadata(std::string_view metadata, size_t blobSize, MeshMetadata& mesh) {
+    MetadataReader reader(metadata);
+    reader.read(mesh.header);
+    mesh.lods = reader.readArray<MeshLod>(mesh.header.lodCount);
+    mesh.vertexBlocks = reader.readArray<uint32_t>(mesh.header.vertexBlockCount);
+    mesh.indexBlocks = reader.readArray<uint32_t>(mesh.header.indexBlockCount);
+    mesh.meshletBlocks = reader.readArray<uint32_t>(mesh.header.meshletBlockCount);
+
+    const MeshHeader& header = mesh.header;
+    if (!reader.ok() || header.blockSize == 0 || header.vertexFormat > (uint32_t) VertexFormat::Quantized16 ||
+        header.indexType > (uint32_t) IndexType::UInt16) {
+        return false;
+    }
+
+    // Buffers are sized in whole vertices and indices, a remainder would be written past them
+    uint64_t meshletBufferSize = (uint64_t) header.meshletCount * sizeof(Meshlet);
+    if (header.vertexBufferSize % vertexFormatStride((VertexFormat) header.vertexFormat) != 0 ||
+        header.indexBufferSize % indexTypeSize((IndexType) header.indexType) != 0 ||
+        !isRunOf(header.vertexBufferSize, header.vertexBlockCount, header.blockSize) ||
+        !isRunOf(header.indexBufferSize, header.indexBlockCount, header.blockSize) ||
+        !isRunOf(meshletBufferSize, header.meshletBlockCount, header.blockSize)) {
+        return false;
+    }
+
+    uint64_t stored = storedSize(mesh.vertexBlocks, header.vertexBlockCount) +
+                      storedSize(mesh.indexBlocks, header.indexBlockCount) +
+                      storedSize(mesh.meshletBlocks, header.meshletBlockCount);
+    return fitsBlob(header.codec, header.vertexBufferSize + header.indexBufferSize + meshletBufferSize, stored,
+                    blobSize);
+}
+
+bool assets::readTextureMetadata(std::string_view metadata, size_t blobSize, TextureMetadata& texture) {
+    MetadataReader reader(metadata);
+    reader.read(texture.header);
+    texture.blocks = reader.readArray<uint32_t>(texture.header.blockCount);
+
+    const TextureHeader& header = texture.header;
+    if (!reader.ok() || header.blockSize == 0 || header.type[31] != '\0' ||
+        header.format > (uint32_t) TextureCompression::BC7 || header.width == 0 || header.width > MAX_TEXTURE_SIZE ||
+        header.height == 0 || header.height > MAX_TEXTURE_SIZE || header.nrComponents < 1 || header.nrComponents > 4 ||
+        header.mipLevels < 1 || header.mipLevels > 32) {
+        return false;
+    }
+
+    // Mip levels are read by offset, so the buffer has to be exactly the chain the header describes
+    Texture shape;
+    shape.width = header.width;
+    shape.height = header.height;
+    shape.nrComponents = header.nrComponents;
+    shape.mipLevels = header.mipLevels;
+    shape.compression = (TextureCompression) header.format;
+    return header.bufferSize == textureDataSize(shape) && isRunOf(header.bufferSize, header.blockCount, header.blockSize) &&
+           fitsBlob(header.codec, header.bufferSize, storedSize(texture.blocks, header.blockCount), blobSize);
+}
+
+bool assets::readSceneMetadata(std::string_view metadata, size_t blobSize, SceneMetadata& scene) {
+    MetadataReader reader(metadata);
+    reader.read(scene.header);
+    scene.blocks = reader.readArray<uint32_t>(scene.header.blockCount);
+
+    const SceneHeader& header = scene.header;
+    if (!reader.ok() || header.blockSize == 0 || header.bufferSize % sizeof(float) != 0 ||
+        !isRunOf(header.bufferSize, header.blockCount, header.blockSize) ||
+        !fitsBlob(header.codec, header.bufferSize, storedSize(scene.blocks, header.blockCount), blobSize)) {
+        return false;
+    }
+    scene.tables = metadata.substr(metadata.size() - reader.remaining());
+
+    // Node and mesh transforms are 16 floats in the buffer. Nodes and clips take at least a name and
+    // a few words in the tables, materials and meshes at least a word.
+    uint64_t matrixSize = 16 * sizeof(float);
+    uint64_t tablesSize = scene.tables.size();
+    return ((uint64_t) header.nodeCount + header.meshCount) * matrixSize <= header.bufferSize &&
+           (uint64_t) header.nodeCount * 8 + (uint64_t) header.materialCount * 4 + (uint64_t) header.meshCount * 4 +
+           (uint64_t) header.clipCount * 16 <= tablesSize;
+}
+
+bool assets::readSkinMetadata(std::string_view metadata, size_t blobSize, SkinMetadata& skin) {
+    MetadataReader reader(metadata);
+    reader.read(skin.header);
+    skin.blocks = reader.readArray<uint32_t>(skin.header.blockCount);
+
+    const SkinHeader& header = skin.header;
+    if (!reader.ok() || header.blockSize == 0) {
+        return false;
+    }
+    skin.boneNames = metadata.substr(metadata.size() - reader.remaining());
+
+    // Offset matrices followed by the weights of every vertex, and a name of at least a word per bone
+    uint64_t bufferSize = (uint64_t) header.boneCount * sizeof(glm::mat4) +
+                          (uint64_t) header.vertexCount * sizeof(VertexBoneData);
+    return header.bufferSize == bufferSize && (uint64_t) header.boneCount * 4 <= skin.boneNames.size() &&
+           isRunOf(header.bufferSize, header.blockCount, header.blockSize) &&
+           fitsBlob(header.codec, header.bufferSize, storedSize(skin.blocks, header.blockCount), blobSize);
+}
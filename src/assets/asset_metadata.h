@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "asset_file.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Asset headers are little endian and read in place"
+#endif
+
+struct MeshLod;
+
+namespace assets {
+
+// Metadata of assets at BINARY_METADATA_VERSION is one of the fixed headers below followed by its
+// tables, each field little endian and each table 4 byte aligned, so it is validated and read
+// straight out of the mapped file. Older assets carry json instead, see asset_json.h.
+
+// Followed by MeshLod[lodCount], then the stored size of each vertex, index and meshlet block
+struct MeshHeader {
+    uint32_t vertexFormat;
+    uint32_t indexType;
+    uint64_t vertexBufferSize;
+    uint64_t indexBufferSize;
+    float boundsMax[4];
+    float boundsMin[4];
+    uint32_t codec;
+    uint32_t blockSize;
+    uint32_t vertexBlockCount;
+    uint32_t indexBlockCount;
+    uint32_t meshletCount;
+    uint32_t meshletBlockCount;
+    uint32_t lodCount;
+    uint32_t reserved;
+};
+
+// Followed by the stored size of each block
+struct TextureHeader {
+    // Material slot the texture was imported for, e.g. texture_diffuse, zero padded
+    char type[32];
+    uint32_t width;
+    uint32_t height;
+    uint32_t nrComponents;
+    uint32_t mipLevels;
+    uint32_t format;
+    uint32_t codec;
+    uint64_t bufferSize;
+    uint32_t blockSize;
+    uint32_t blockCount;
+};
+
+// Followed by the block sizes, then per node its parent and name, per material its texture count
+// and paths, the material of each mesh, and per clip its name, duration, ticks per second and
+// channels with their node name and key counts. Transforms and keys are in the blob.
+struct SceneHeader {
+    uint32_t nodeCount;
+    uint32_t materialCount;
+    uint32_t meshCount;
+    uint32_t clipCount;
+    uint64_t bufferSize;
+    uint32_t codec;
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint32_t reserved;
+};
+
+// Followed by the block sizes and one name per bone. Offset matrices and weights are in the blob.
+struct SkinHeader {
+    uint32_t boneCount;
+    uint32_t vertexCount;
+    uint64_t bufferSize;
+    uint32_t codec;
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint32_t reserved;
+};
+
+// Followed by sourceCount sources, then per texture source its path, type and source
+struct InfoHeader {
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint32_t importerFlags;
+    uint32_t converterVersion;
+    uint32_t sourceCount;
+    uint32_t textureSourceCount;
+};
+
+// A SourceFile, followed by its path
+struct SourceRecord {
+    uint64_t size;
+    int64_t modifiedTime;
+    uint64_t hash;
+};
+
+static_assert(sizeof(MeshHeader) == 88, "MeshHeader is written to disk as is");
+static_assert(sizeof(TextureHeader) == 72, "TextureHeader is written to disk as is");
+static_assert(sizeof(SceneHeader) == 40, "SceneHeader is written to disk as is");
+static_assert(sizeof(SkinHeader) == 32, "SkinHeader is written to disk as is");
+static_assert(sizeof(InfoHeader) == 24, "InfoHeader is written to disk as is");
+static_assert(sizeof(SourceRecord) == 24, "SourceRecord is written to disk as is");
+
+// Builds a metadata section. Strings are a 32 bit length and their bytes, padded to 4.
+class MetadataWriter {
+public:
+    template<typename T>
+    void write(const T& value) {
+        writeArray(&value, 1);
+    }
+
+    template<typename T>
+    void writeArray(const T* values, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0, "Tables stay 4 byte aligned");
+        data.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+    }
+
+    void writeString(std::string_view value);
+
+    std::string data;
+};
+
+// Reads a metadata section without copying its tables. Every read is checked against the end and
+// fails from then on once one doesn't fit.
+class MetadataReader {
+public:
+    explicit MetadataReader(std::string_view metadata) : metadata(metadata) {}
+
+    template<typename T>
+    bool read(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only plain records are read");
+        const char* source = take(sizeof(T), 1);
+        if (source == nullptr) return false;
+        memcpy(&value, source, sizeof(T));
+        return true;
+    }
+
+    // Points into the metadata, null when the table runs past the end or isn't aligned for T
+    template<typename T>
+    const T* readArray(size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0, "Tables stay 4 byte aligned");
+        return reinterpret_cast<const T*>(take(count * sizeof(T), alignof(T)));
+    }
+
+    bool readString(std::string_view& value);
+
+    bool ok() const { return !failed; }
+    // Bytes after the last read
+    size_t remaining() const { return metadata.size() - position; }
+
+private:
+    std::string_view metadata;
+    size_t position = 0;
+    bool failed = false;
+
+    const char* take(size_t size, size_t alignment);
+};
+
+// Checks the four character type and version of an asset before its header is read
+bool hasBinaryMetadata(const AssetFileView& file, const char (&type)[5]);
+
+// A mesh or texture header and its tables, pointing into the metadata it was read from
+struct MeshMetadata {
+    MeshHeader header;
+    const MeshLod* lods;
+    const uint32_t* vertexBlocks;
+    const uint32_t* indexBlocks;
+    const uint32_t* meshletBlocks;
+};
+
+struct TextureMetadata {
+    TextureHeader header;
+    const uint32_t* blocks;
+};
+
+// Scene and skin headers, with the tables after their blocks left to be read by the converter
+struct SceneMetadata {
+    SceneHeader header;
+    const uint32_t* blocks;
+    std::string_view tables;
+};
+
+struct SkinMetadata {
+    SkinHeader header;
+    const uint32_t* blocks;
+    std::string_view boneNames;
+};
+
+// Largest width or height a texture header may claim
+constexpr uint32_t MAX_TEXTURE_SIZE = 65536;
+
+// Read the header and tables and check them against the blob they describe: enums in range, buffer
+// sizes whole elements covered by their blocks, and no more raw data than blobSize can decode to.
+// Nothing is allocated from a header that fails.
+bool readMeshMetadata(std::string_view metadata, size_t blobSize, MeshMetadata& mesh);
+bool readTextureMetadata(std::string_view metadata, size_t blobSize, TextureMetadata& texture);
+// Counts are also bounded by what their records take up in the buffer or the tables
+bool readSceneMetadata(std::string_view metadata, size_t blobSize, SceneMetadata& scene);
+bool readSkinMetadata(std::string_view metadata, size_t blobSize, SkinMetadata& skin);
+}
@@ -0,0 +1,180 @@
+#include "asset_pack.h"
+
+#include <cstring>
+
+namespace {
+    constexpr char PACK_MAGIC[4] = {'G', 'L', 'P', 'K'};
+    // Version 1 entries are the first 40 bytes of the current layout, without source information
+    constexpr size_t PACK_ENTRY_SIZE_V1 = 40;
+
+    void padTo(std::ofstream& output, uint64_t alignment) {
+        static const char zeros[assets::PACK_ALIGNMENT] = {};
+
+        uint64_t position = output.tellp();
+        uint64_t padding = (alignment - position % alignment) % alignment;
+        output.write(zeros, padding);
+    }
+}
+
+const char* assets::packEntryTypeName(PackEntryType type) {
+    switch (type) {
+        case PackEntryType::Info: return "info";
+        case PackEntryType::Mesh: return "mesh";
+        case PackEntryType::Texture: return "texture";
+        case PackEntryType::Scene: return "scene";
+        case PackEntryType::Skin: return "skin";
+    }
+    return "unknown";
+}
+
+bool assets::PackWriter::open(const std::string& path) {
+    entries.clear();
+    output.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+
+    if (!output.is_open()) {
+        return false;
+    }
+
+    // Placeholder, the real header is written once the table of contents is known
+    PackHeader header{};
+    output.write((const char*) &header, sizeof(PackHeader));
+
+    return !output.fail();
+}
+
+bool assets::PackWriter::add(PackEntryType type, uint32_t index, const AssetFile& file) {
+    PackEntry entry{};
+    entry.type = type;
+    entry.index = index;
+
+    return add(entry, file);
+}
+
+bool assets::PackWriter::add(PackEntry entry, const AssetFile& file) {
+    padTo(output, PACK_ALIGNMENT);
+
+    entry.codec = file.codec;
+    entry.codecLevel = file.codecLevel;
+    entry.offset = output.tellp();
+    entry.uncompressedSize = file.rawBlobSize;
+
+    if (!writeBinaryFile(output, file)) {
+        return false;
+    }
+
+    entry.size = (uint64_t) output.tellp() - entry.offset;
+    entries.push_back(entry);
+
+    return true;
+}
+
+bool assets::PackWriter::addCopy(PackEntry entry, const char* payload) {
+    padTo(output, PACK_ALIGNMENT);
+
+    entry.offset = output.tellp();
+    output.write(payload, entry.size);
+    if (output.fail()) {
+        return false;
+    }
+
+    entries.push_back(entry);
+    return true;
+}
+
+bool assets::PackWriter::finish() {
+    padTo(output, alignof(PackEntry));
+
+    PackHeader header{};
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.entryCount = entries.size();
+    header.tocOffset = output.tellp();
+
+    output.write((const char*) entries.data(), entries.size() * sizeof(PackEntry));
+
+    output.seekp(0);
+    output.write((const char*) &header, sizeof(PackHeader));
+    output.close();
+
+    return !output.fail();
+}
+
+bool assets::PackReader::open(const std::string& path) {
+    entries.clear();
+
+    if (!mapping.open(path) || mapping.size() < sizeof(PackHeader)) {
+        return false;
+    }
+
+    PackHeader header{};
+    memcpy(&header, mapping.data(), sizeof(PackHeader));
+
+    if (memcmp(header.magic, PACK_MAGIC, 4) != 0 || header.version == 0 || header.version > PACK_VERSION) {
+        return false;
+    }
+
+    size_t entrySize = header.version == 1 ? PACK_ENTRY_SIZE_V1 : sizeof(PackEntry);
+    // Compared against what is left after the offset, a crafted offset plus size could wrap around
+    uint64_t size = mapping.size();
+    uint64_t tocSize = (uint64_t) header.entryCount * entrySize;
+    if (header.tocOffset > size || tocSize > size - header.tocOffset) {
+        return false;
+    }
+
+    // Older entries are zero extended, so they never match any source and get rebuilt
+    entries.assign(header.entryCount, PackEntry{});
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        memcpy(&entries[i], mapping.data() + header.tocOffset + i * entrySize, entrySize);
+    }
+
+    for (const PackEntry& entry : entries) {
+        if (entry.offset > size || entry.size > size - entry.offset) {
+            entries.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void assets::PackReader::close() {
+    entries.clear();
+    mapping.close();
+}
+
+const assets::PackEntry* assets::PackReader::find(PackEntryType type, uint32_t index) const {
+    for (const PackEntry& entry : entries) {
+        if (entry.type == type && entry.index == index) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+const assets::PackEntry* assets::PackReader::findByKey(PackEntryType type, uint64_t sourceKey) const {
+    for (const PackEntry& entry : entries) {
+        if (entry.type == type && entry.sourceKey == sourceKey) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+size_t assets::PackReader::count(PackEntryType type) const {
+    size_t total = 0;
+    for (const PackEntry& entry : entries) {
+        if (entry.type == type) total++;
+    }
+
+    return total;
+}
+
+bool assets::PackReader::view(const PackEntry& entry, AssetFileView& file) const {
+    return parseBinaryFile(mapping.data() + entry.offset, entry.size, file);
+}
+
+void assets::PackReader::prefetch(const PackEntry& entry) const {
+    mapping.prefetch(entry.offset, entry.size);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "asset_file.h"
+
+namespace assets {
+
+// A pack stores every asset of a model in one file:
+//   PackHeader | payload | payload | ... | PackEntry[entryCount]
+// Payloads are regular asset files, each starting on a PACK_ALIGNMENT boundary so they can
+// be read with large aligned reads (or mapped) independently of each other.
+constexpr uint64_t PACK_ALIGNMENT = 4096;
+constexpr uint32_t PACK_VERSION = 2;
+
+enum class PackEntryType : uint32_t {
+    Info = 0,
+    Mesh = 1,
+    Texture = 2,
+    // Node hierarchy, materials and animation clips, one per pack
+    Scene = 3,
+    // Bone weights and offsets of a skinned mesh, same index as the mesh
+    Skin = 4
+};
+
+const char* packEntryTypeName(PackEntryType type);
+
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t tocOffset;
+};
+
+struct PackEntry {
+    PackEntryType type;
+    // Position among the entries of the same type, e.g. mesh 3
+    uint32_t index;
+    Codec codec;
+    // Everything that decides the payload bytes: postprocess flags of the import, converter
+    // version, and a hash of the source data. An entry whose inputs all match can be reused.
+    uint32_t importerFlags;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t uncompressedSize;
+    // Identifies the source across imports when indices shift, e.g. a hash of a texture path
+    uint64_t sourceKey;
+    uint64_t sourceHash;
+    uint32_t converterVersion;
+    // Level the payload was compressed at, a different level means different bytes
+    uint32_t codecLevel;
+};
+
+static_assert(sizeof(PackHeader) == 24, "PackHeader is written to disk as is");
+static_assert(sizeof(PackEntry) == 64, "PackEntry is written to disk as is");
+
+class PackWriter {
+public:
+    bool open(const std::string& path);
+    bool add(PackEntryType type, uint32_t index, const AssetFile& file);
+    // Offset, size, codec, codec level and uncompressed size of `entry` are filled in from the file
+    bool add(PackEntry entry, const AssetFile& file);
+    // Copies an already built payload, e.g. an unchanged entry of an older pack
+    bool addCopy(PackEntry entry, const char* payload);
+    // Writes the table of contents and header. Nothing is readable until this succeeds.
+    bool finish();
+
+private:
+    std::ofstream output;
+    std::vector<PackEntry> entries;
+};
+
+class PackReader {
+public:
+    bool open(const std::string& path);
+    void close();
+
+    const std::vector<PackEntry>& getEntries() const { return entries; }
+    const PackEntry* find(PackEntryType type, uint32_t index) const;
+    const PackEntry* findByKey(PackEntryType type, uint64_t sourceKey) const;
+    size_t count(PackEntryType type) const;
+
+    bool view(const PackEntry& entry, AssetFileView& file) const;
+    void prefetch(const PackEntry& entry) const;
+    const char* payload(const PackEntry& entry) const { return mapping.data() + entry.offset; }
+
+private:
+    MappedFile mapping;
+    std::vector<PackEntry> entries;
+};
+}
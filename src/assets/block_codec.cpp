@@ -0,0 +1,228 @@
+#include "block_codec.h"
+
+#include <lz4.h>
+#include <lz4hc.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+
+#include "core/job_system.h"
+
+namespace {
+    size_t storedBound(size_t size) {
+        return size;
+    }
+
+    size_t store(const char* source, size_t size, char* destination, size_t capacity, int) {
+        if (size > capacity) return 0;
+        memcpy(destination, source, size);
+        return size;
+    }
+
+    bool load(const char* source, size_t storedSize, char* destination, size_t size) {
+        if (storedSize != size) return false;
+        memcpy(destination, source, size);
+        return true;
+    }
+
+    size_t lz4Bound(size_t size) {
+        return LZ4_compressBound(size);
+    }
+
+    size_t lz4Compress(const char* source, size_t size, char* destination, size_t capacity, int) {
+        return std::max(LZ4_compress_default(source, destination, size, capacity), 0);
+    }
+
+    size_t lz4hcCompress(const char* source, size_t size, char* destination, size_t capacity, int level) {
+        return std::max(LZ4_compress_HC(source, destination, size, capacity, level), 0);
+    }
+
+    bool lz4Decompress(const char* source, size_t storedSize, char* destination, size_t size) {
+        return LZ4_decompress_safe(source, destination, storedSize, size) == (int) size;
+    }
+}
+
+const std::vector<assets::CodecInfo>& assets::codecRegistry() {
+    static const std::vector<CodecInfo> codecs = {
+        // A run of LZ4 match length bytes adds 255 bytes each, so nothing decodes to more than 256 times its size
+        {Codec::None, "none", 0, 0, 0, 1, storedBound, store, load},
+        {Codec::LZ4, "lz4", 0, 0, 0, 256, lz4Bound, lz4Compress, lz4Decompress},
+        {Codec::LZ4HC, "lz4hc", LZ4HC_CLEVEL_MIN, LZ4HC_CLEVEL_MAX, LZ4HC_CLEVEL_DEFAULT, 256, lz4Bound,
+         lz4hcCompress, lz4Decompress},
+    };
+    return codecs;
+}
+
+const assets::CodecInfo* assets::findCodec(Codec codec) {
+    for (const CodecInfo& info : codecRegistry()) {
+        if (info.codec == codec) return &info;
+    }
+    return nullptr;
+}
+
+const assets::CodecInfo* assets::findCodec(std::string_view name) {
+    for (const CodecInfo& info : codecRegistry()) {
+        if (name == info.name) return &info;
+    }
+    return nullptr;
+}
+
+bool assets::parseCodecSettings(std::string_view text, CodecSettings& settings) {
+    size_t separator = text.find(':');
+    const CodecInfo* info = findCodec(text.substr(0, separator));
+    if (info == nullptr) return false;
+
+    int level = 0;
+    if (separator != std::string_view::npos) {
+        std::string_view levelText = text.substr(separator + 1);
+        auto [end, error] = std::from_chars(levelText.data(), levelText.data() + levelText.size(), level);
+        if (error != std::errc() || end != levelText.data() + levelText.size() ||
+            level < info->minLevel || level > info->maxLevel) {
+            return false;
+        }
+    }
+
+    settings = {info->codec, level};
+    return true;
+}
+
+std::string assets::codecSettingsName(const CodecSettings& settings) {
+    const CodecInfo* info = findCodec(settings.codec);
+    if (info == nullptr) return "unknown";
+
+    std::string name = info->name;
+    if (info->maxLevel > 0) name += ":" + std::to_string(resolvedCodecLevel(settings));
+    return name;
+}
+
+int assets::resolvedCodecLevel(const CodecSettings& settings) {
+    const CodecInfo* info = findCodec(settings.codec);
+    if (info == nullptr || info->maxLevel == 0) return 0;
+    return settings.level == 0 ? info->defaultLevel : std::clamp(settings.level, info->minLevel, info->maxLevel);
+}
+
+std::vector<uint32_t> assets::compressBlocks(std::vector<char>& blob, const void* data, size_t size,
+                                             const CodecSettings& settings, size_t blockSize) {
+    const CodecInfo* codec = findCodec(settings.codec);
+    int level = resolvedCodecLevel(settings);
+    size_t numBlocks = (size + blockSize - 1) / blockSize;
+    std::vector<uint32_t> storedSizes(numBlocks);
+
+    // Stored blocks are appended as is
+    if (codec == nullptr || settings.codec == Codec::None) {
+        size_t offset = blob.size();
+        blob.resize(offset + size);
+        memcpy(blob.data() + offset, data, size);
+
+        for (size_t i = 0; i < numBlocks; i++) {
+            storedSizes[i] = std::min(blockSize, size - i * blockSize);
+        }
+        return storedSizes;
+    }
+
+    std::vector<std::vector<char>> compressedBlocks(numBlocks);
+    JobSystem::shared().parallelFor(numBlocks, [&](size_t i) {
+        const char* blockData = (const char*) data + i * blockSize;
+        size_t rawSize = std::min(blockSize, size - i * blockSize);
+
+        std::vector<char>& compressed = compressedBlocks[i];
+        compressed.resize(codec->compressBound(rawSize));
+        compressed.resize(codec->compress(blockData, rawSize, compressed.data(), compressed.size(), level));
+    });
+
+    for (size_t i = 0; i < numBlocks; i++) {
+        storedSizes[i] = compressedBlocks[i].size();
+        blob.insert(blob.end(), compressedBlocks[i].begin(), compressedBlocks[i].end());
+    }
+
+    return storedSizes;
+}
+
+bool assets::decompressBlocks(const char* source, size_t sourceSize, const uint32_t* storedSizes, size_t blockCount,
+                              void* destination, size_t size, Codec codec, size_t blockSize,
+                              const BlockCallback& onBlockDecoded, size_t callbackOffset) {
+    const CodecInfo* info = findCodec(codec);
+    size_t numBlocks = blockCount;
+    if (info == nullptr || numBlocks != (size + blockSize - 1) / blockSize) {
+        return false;
+    }
+
+    std::vector<size_t> sourceOffsets(numBlocks);
+    size_t totalStored = 0;
+    for (size_t i = 0; i < numBlocks; i++) {
+        sourceOffsets[i] = totalStored;
+        totalStored += storedSizes[i];
+    }
+    if (totalStored > sourceSize) {
+        return false;
+    }
+
+    std::atomic<bool> failed = false;
+    JobSystem::shared().parallelFor(numBlocks, [&](size_t i) {
+        const char* blockSource = source + sourceOffsets[i];
+        char* blockDestination = (char*) destination + i * blockSize;
+        size_t rawSize = std::min(blockSize, size - i * blockSize);
+
+        if (!info->decompress(blockSource, storedSizes[i], blockDestination, rawSize)) {
+            failed = true;
+        }
+        else if (onBlockDecoded) {
+            onBlockDecoded(callbackOffset + i * blockSize, rawSize);
+        }
+    });
+
+    return !failed;
+}
+
+bool assets::decompressBlockRange(const char* source, size_t sourceSize, const uint32_t* storedSizes, size_t blockCount,
+                                  size_t size, Codec codec, size_t blockSize, size_t rawOffset, size_t rawSize,
+                                  void* destination) {
+    const CodecInfo* info = findCodec(codec);
+    if (info == nullptr || blockCount != (size + blockSize - 1) / blockSize || rawOffset + rawSize > size) {
+        return false;
+    }
+    if (rawSize == 0) {
+        return true;
+    }
+
+    size_t firstBlock = rawOffset / blockSize, lastBlock = (rawOffset + rawSize - 1) / blockSize;
+    std::vector<size_t> sourceOffsets(lastBlock + 2);
+    for (size_t i = 0; i <= lastBlock; i++) {
+        sourceOffsets[i + 1] = sourceOffsets[i] + storedSizes[i];
+    }
+    if (sourceOffsets[lastBlock + 1] > sourceSize) {
+        return false;
+    }
+
+    std::atomic<bool> failed = false;
+    JobSystem::shared().parallelFor(lastBlock - firstBlock + 1, [&](size_t i) {
+        size_t block = firstBlock + i;
+        size_t blockStart = block * blockSize;
+        size_t blockRawSize = std::min(blockSize, size - blockStart);
+        const char* blockSource = source + sourceOffsets[block];
+
+        // Stored blocks are copied from in place
+        std::vector<char> decoded;
+        if (codec == Codec::None) {
+            if (storedSizes[block] != blockRawSize) {
+                failed = true;
+                return;
+            }
+        }
+        else {
+            decoded.resize(blockRawSize);
+            if (!info->decompress(blockSource, storedSizes[block], decoded.data(), blockRawSize)) {
+                failed = true;
+                return;
+            }
+            blockSource = decoded.data();
+        }
+
+        size_t copyStart = std::max(rawOffset, blockStart);
+        size_t copyEnd = std::min(rawOffset + rawSize, blockStart + blockRawSize);
+        memcpy((char*) destination + (copyStart - rawOffset), blockSource + (copyStart - blockStart), copyEnd - copyStart);
+    });
+
+    return !failed;
+}
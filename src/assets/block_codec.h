@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "asset_file.h"
+
+namespace assets {
+
+// Raw data is cut into blocks of this size and each block is compressed on its own, so one
+// large blob can be decoded by several threads and consumed before all of it is done.
+constexpr size_t BLOCK_SIZE = 256 * 1024;
+
+// A codec and the level to bake with. Level 0 picks the codec's default.
+struct CodecSettings {
+    Codec codec = Codec::LZ4;
+    int level = 0;
+};
+
+// How blocks of one codec are stored. LZ4HC writes plain LZ4 blocks, so it only costs at bake time.
+struct CodecInfo {
+    Codec codec;
+    const char* name;
+    int minLevel, maxLevel, defaultLevel;
+    // Most raw bytes one stored byte can decode to, bounds what a header can make a loader allocate
+    uint64_t maxRatio;
+
+    size_t (*compressBound)(size_t size);
+    // Returns the stored size, 0 on failure
+    size_t (*compress)(const char* source, size_t size, char* destination, size_t capacity, int level);
+    // True when the block decoded to exactly `size` bytes
+    bool (*decompress)(const char* source, size_t storedSize, char* destination, size_t size);
+};
+
+// Every codec blocks can be stored with, in Codec order
+const std::vector<CodecInfo>& codecRegistry();
+// Null for codecs this build can't read
+const CodecInfo* findCodec(Codec codec);
+const CodecInfo* findCodec(std::string_view name);
+
+// Parses "none", "lz4" or "lz4hc:9" style settings, rejecting levels out of the codec's range
+bool parseCodecSettings(std::string_view text, CodecSettings& settings);
+std::string codecSettingsName(const CodecSettings& settings);
+// Level 0 replaced by the codec's default
+int resolvedCodecLevel(const CodecSettings& settings);
+
+// Called from the decoding thread once [rawOffset, rawOffset + rawSize) of the output is ready
+using BlockCallback = std::function<void(size_t rawOffset, size_t rawSize)>;
+
+// Appends `size` bytes to the blob as a run of blocks and returns the stored size of each block
+std::vector<uint32_t> compressBlocks(std::vector<char>& blob, const void* data, size_t size,
+                                     const CodecSettings& settings, size_t blockSize = BLOCK_SIZE);
+
+// Decodes a run of blocks written by compressBlocks, storedSizes holds blockCount entries. Blocks are
+// decoded in parallel when there is more than one. `callbackOffset` is added to the offsets handed to onBlockDecoded.
+bool decompressBlocks(const char* source, size_t sourceSize, const uint32_t* storedSizes, size_t blockCount,
+                      void* destination, size_t size, Codec codec, size_t blockSize = BLOCK_SIZE,
+                      const BlockCallback& onBlockDecoded = nullptr, size_t callbackOffset = 0);
+
+// Decodes only the blocks overlapping [rawOffset, rawOffset + rawSize) of a run of `size` raw bytes
+// and copies that range to destination
+bool decompressBlockRange(const char* source, size_t sourceSize, const uint32_t* storedSizes, size_t blockCount,
+                          size_t size, Codec codec, size_t blockSize, size_t rawOffset, size_t rawSize,
+                          void* destination);
+}
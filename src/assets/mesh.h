@@ -6,17 +6,97 @@
 #define MESH_H
 #include <vector>
 #include <utils/types.h>
+#include "assets/vertex_format.h"
+
+// A simplified version of a mesh, drawn from a range of its index buffer
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    // How far the simplified surface may deviate from the full one, in mesh units
+    float error;
+};
+
+// A run of at most 124 triangles over at most 64 vertices in the full index buffer, with
+// bounds for culling it on its own. Stored as is in mesh assets.
+struct Meshlet {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+
+    glm::vec3 center;
+    float radius;
+
+    // Every triangle faces away from cameras inside the cone around -coneAxis with its tip at coneApex.
+    // coneCutoff is the sine of the cone's half angle, 1 when the triangles face too many ways to cull.
+    glm::vec3 coneApex;
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+static_assert(sizeof(Meshlet) == 52, "Meshlet is stored as raw bytes");
+
+// How much of a mesh stays in CPU memory once it is on the GPU
+enum class GeometryResidency {
+    // Everything, for picking, physics or rebaking
+    Keep,
+    // Float positions and the indices, enough for CPU side queries
+    PositionsOnly,
+    // Nothing but the counts drawing needs
+    Release
+};
 
 struct Mesh {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
 
+    // Baked meshes may keep their vertices packed for the GPU in packedVertices instead of vertices
+    assets::VertexFormat vertexFormat = assets::VertexFormat::Float32;
+    std::vector<char> packedVertices;
+
+    // Baked meshes with few enough vertices keep 16 bit indices in shortIndices instead of indices
+    assets::IndexType indexType = assets::IndexType::UInt32;
+    std::vector<uint16_t> shortIndices;
+
+    // Finest first, lods[0] covers the full mesh. Empty when the mesh has a single level,
+    // otherwise the index buffer holds every level back to back.
+    std::vector<MeshLod> lods;
+    // Clusters of the full resolution level, empty for meshes too small to be worth splitting
+    std::vector<Meshlet> meshlets;
+
     size_t materialIndex;
 
     glm::mat4 model_matrix;
     BoundingBox aabb;
 
     AllocatedBuffer buffer;
+
+    // Set once the arrays above were dropped after upload
+    GeometryResidency residency = GeometryResidency::Keep;
+    // Positions left by GeometryResidency::PositionsOnly
+    std::vector<glm::vec3> positions;
+    // What the GPU buffers hold, for meshes whose arrays were released
+    size_t gpuVertexCount = 0, gpuIndexCount = 0;
+
+    size_t vertexCount() const {
+        if (residency == GeometryResidency::PositionsOnly) return positions.size();
+        if (residency == GeometryResidency::Release) return gpuVertexCount;
+        if (vertexFormat == assets::VertexFormat::Float32) return vertices.size();
+        return packedVertices.size() / assets::vertexFormatStride(vertexFormat);
+    }
+
+    size_t indexCount() const {
+        if (residency == GeometryResidency::Release) return gpuIndexCount;
+        return indexType == assets::IndexType::UInt16 ? shortIndices.size() : indices.size();
+    }
+
+    const void* indexData() const {
+        if (indexType == assets::IndexType::UInt16) return shortIndices.data();
+        return indices.data();
+    }
+
+    // Bytes of vertex and index data held on the CPU
+    size_t cpuBytes() const {
+        return vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int) + packedVertices.size() +
+               shortIndices.size() * sizeof(uint16_t) + positions.size() * sizeof(glm::vec3);
+    }
 };
 
 #endif //MESH_H
@@ -0,0 +1,306 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+    constexpr unsigned int INVALID_INDEX = ~0u;
+
+    // Hashes and compares the attribute bytes of a vertex, leaving out the ID
+    struct VertexKey {
+        const Vertex* vertices;
+        const char* extraData;
+        size_t extraStride;
+
+        size_t hash(unsigned int index) const {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(&vertices[index]);
+            size_t result = 14695981039346656037ull;
+            for (size_t i = 0; i < offsetof(Vertex, ID); i++) {
+                result = (result ^ bytes[i]) * 1099511628211ull;
+            }
+            for (size_t i = 0; i < extraStride; i++) {
+                result = (result ^ (unsigned char) extraData[index * extraStride + i]) * 1099511628211ull;
+            }
+            return result;
+        }
+
+        bool equal(unsigned int a, unsigned int b) const {
+            return memcmp(&vertices[a], &vertices[b], offsetof(Vertex, ID)) == 0 &&
+                   (extraStride == 0 ||
+                    memcmp(extraData + a * extraStride, extraData + b * extraStride, extraStride) == 0);
+        }
+    };
+
+    // Sander et al., pick the vertex adjacent to the last fan that will still be in the cache
+    // when its remaining triangles are emitted, preferring the one that entered it earliest
+    int nextFanVertex(const std::vector<unsigned int>& candidates, const std::vector<unsigned int>& liveTriangles,
+                      const std::vector<unsigned int>& cacheTime, unsigned int timestamp, unsigned int cacheSize) {
+        int best = -1;
+        int bestPriority = -1;
+
+        for (unsigned int vertex : candidates) {
+            if (liveTriangles[vertex] == 0) continue;
+
+            int priority = 0;
+            if (timestamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = timestamp - cacheTime[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = vertex;
+            }
+        }
+
+        return best;
+    }
+}
+
+assets::VertexCacheStats assets::analyzeVertexCache(const unsigned int* indices, size_t indexCount,
+                                                    size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0) return stats;
+
+    // FIFO cache, a vertex is in it while fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int vertex = indices[i];
+        if (loadedAt[vertex] == 0 || misses - loadedAt[vertex] >= cacheSize) {
+            misses++;
+            loadedAt[vertex] = misses;
+        }
+    }
+
+    stats.acmr = (float) misses / (indexCount / 3);
+    stats.atvr = (float) misses / vertexCount;
+    return stats;
+}
+
+size_t assets::weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                            std::vector<unsigned int>& remap, const void* extraData, size_t extraStride) {
+    VertexKey key{vertices.data(), static_cast<const char*>(extraData), extraData ? extraStride : 0};
+
+    auto hash = [&key](unsigned int index) { return key.hash(index); };
+    auto equal = [&key](unsigned int a, unsigned int b) { return key.equal(a, b); };
+    std::unordered_map<unsigned int, unsigned int, decltype(hash), decltype(equal)> firstOccurrence(
+        vertices.size(), hash, equal);
+
+    remap.resize(vertices.size());
+    size_t uniqueCount = 0;
+    for (unsigned int i = 0; i < vertices.size(); i++) {
+        auto [iterator, inserted] = firstOccurrence.emplace(i, (unsigned int) uniqueCount);
+        if (inserted) uniqueCount++;
+        remap[i] = iterator->second;
+    }
+
+    size_t welded = vertices.size() - uniqueCount;
+    if (welded == 0) return 0;
+
+    // First occurrences keep their relative order, so writing forward never overwrites a pending source
+    for (unsigned int i = 0; i < vertices.size(); i++) {
+        vertices[remap[i]] = vertices[i];
+    }
+    vertices.resize(uniqueCount);
+
+    for (unsigned int& index : indices) {
+        index = remap[index];
+    }
+
+    return welded;
+}
+
+void assets::optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                 unsigned int cacheSize, std::vector<size_t>* clusterStarts) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // Triangles using each vertex, as offsets into one flat array
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        liveTriangles[indices[i]]++;
+    }
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+    }
+
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        for (int corner = 0; corner < 3; corner++) {
+            adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+
+    unsigned int timestamp = cacheSize + 1;
+    size_t cursor = 0;
+    int fanVertex = 0;
+
+    if (clusterStarts) {
+        clusterStarts->clear();
+        clusterStarts->push_back(0);
+    }
+
+    while (fanVertex >= 0) {
+        candidates.clear();
+
+        for (unsigned int i = adjacencyOffsets[fanVertex]; i < adjacencyOffsets[fanVertex + 1]; i++) {
+            unsigned int triangle = adjacency[i];
+            if (emitted[triangle]) continue;
+
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+
+                if (timestamp - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = timestamp++;
+                }
+            }
+            emitted[triangle] = 1;
+        }
+
+        fanVertex = nextFanVertex(candidates, liveTriangles, cacheTime, timestamp, cacheSize);
+        if (fanVertex >= 0) continue;
+
+        // Dead end: fall back to recently used vertices, then to the next vertex in input order
+        while (!deadEnds.empty() && fanVertex < 0) {
+            unsigned int vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0) fanVertex = vertex;
+        }
+        while (fanVertex < 0 && cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) fanVertex = cursor;
+            cursor++;
+        }
+
+        if (fanVertex >= 0 && clusterStarts && output.size() > clusterStarts->back()) {
+            clusterStarts->push_back(output.size());
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void assets::optimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices,
+                              const std::vector<size_t>& clusterStarts) {
+    size_t clusterCount = clusterStarts.size();
+    if (clusterCount < 2) return;
+
+    struct Cluster {
+        size_t begin, end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+
+    std::vector<Cluster> clusters(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t i = 0; i < clusterCount; i++) {
+        Cluster& cluster = clusters[i];
+        cluster.begin = clusterStarts[i];
+        cluster.end = i + 1 < clusterCount ? clusterStarts[i + 1] : indexCount - indexCount % 3;
+        cluster.centroid = glm::vec3(0.0f);
+        cluster.normal = glm::vec3(0.0f);
+
+        float area = 0.0f;
+        for (size_t j = cluster.begin; j < cluster.end; j += 3) {
+            const glm::vec3& a = vertices[indices[j]].Position;
+            const glm::vec3& b = vertices[indices[j + 1]].Position;
+            const glm::vec3& c = vertices[indices[j + 2]].Position;
+
+            // Length of the cross product is twice the area, the factor cancels out
+            glm::vec3 weightedNormal = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(weightedNormal);
+
+            cluster.centroid += (a + b + c) * (triangleArea / 3.0f);
+            cluster.normal += weightedNormal;
+            area += triangleArea;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += area;
+        if (area > 0.0f) cluster.centroid /= area;
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    for (Cluster& cluster : clusters) {
+        float length = glm::length(cluster.normal);
+        glm::vec3 normal = length > 0.0f ? cluster.normal / length : glm::vec3(0.0f);
+        cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, normal);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(indexCount);
+    for (const Cluster& cluster : clusters) {
+        sorted.insert(sorted.end(), indices + cluster.begin, indices + cluster.end);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void assets::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                 std::vector<unsigned int>& remap) {
+    remap.assign(vertices.size(), INVALID_INDEX);
+
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (unsigned int& index : indices) {
+        if (remap[index] == INVALID_INDEX) {
+            remap[index] = reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+assets::MeshOptimizationReport assets::optimizeMesh(Mesh& mesh, bool reorderForOverdraw, std::vector<unsigned int>& remap,
+                                                    const void* extraData, size_t extraStride) {
+    MeshOptimizationReport report;
+    report.before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+    std::vector<unsigned int> weldRemap, fetchRemap;
+    report.weldedVertices = weldVertices(mesh.vertices, mesh.indices, weldRemap, extraData, extraStride);
+
+    std::vector<size_t> clusterStarts;
+    optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), VERTEX_CACHE_SIZE,
+                        &clusterStarts);
+    report.clusters = clusterStarts.size();
+    if (reorderForOverdraw) {
+        optimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), clusterStarts);
+    }
+
+    optimizeVertexFetch(mesh.vertices, mesh.indices, fetchRemap);
+
+    remap.resize(weldRemap.size());
+    for (size_t i = 0; i < weldRemap.size(); i++) {
+        remap[i] = fetchRemap[weldRemap[i]];
+    }
+
+    // IDs index per-vertex side data such as bone weights, keep them equal to the vertex index
+    for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+        mesh.vertices[i].ID = i;
+    }
+
+    report.after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    return report;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "assets/mesh.h"
+
+namespace assets {
+
+// Post-transform cache size the optimizer targets and reports against. Small enough to help
+// on older FIFO caches without hurting GPUs with larger ones.
+constexpr unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    // Vertices transformed per triangle, 0.5 is the best possible on a regular grid, 3 the worst
+    float acmr = 0.0f;
+    // Vertices transformed per unique vertex, 1 is ideal
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t weldedVertices = 0;
+    size_t clusters = 0;
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Merges vertices whose attributes are bitwise identical (ignoring Vertex::ID). `extraData` adds
+// a per-vertex record, e.g. bone weights, that must match as well. remap maps old -> new indices.
+size_t weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                    std::vector<unsigned int>& remap, const void* extraData = nullptr, size_t extraStride = 0);
+
+// Tipsify (Sander et al. 2007). Reorders triangles in place; `clusterStarts` receives the first
+// index of every run that had to restart at a dead end, which is where overdraw sorting can cut.
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+                         unsigned int cacheSize = VERTEX_CACHE_SIZE, std::vector<size_t>* clusterStarts = nullptr);
+
+// Sorts the clusters found by optimizeVertexCache so ones facing away from the mesh center are
+// drawn first, which occludes more of the rest from most view directions
+void optimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices,
+                      const std::vector<size_t>& clusterStarts);
+
+// Renumbers vertices in order of first use so fetches walk the vertex buffer linearly.
+// Unreferenced vertices are dropped and map to ~0u in remap.
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                         std::vector<unsigned int>& remap);
+
+// Runs every stage on a Float32 mesh. remap maps the original vertex indices to the final ones
+// (~0u for dropped vertices) so per-vertex data kept elsewhere can follow.
+MeshOptimizationReport optimizeMesh(Mesh& mesh, bool reorderForOverdraw, std::vector<unsigned int>& remap,
+                                    const void* extraData = nullptr, size_t extraStride = 0);
+}
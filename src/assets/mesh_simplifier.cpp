@@ -0,0 +1,236 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+    // Symmetric 4x4 matrix, stored as its upper triangle
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+
+        static Quadric fromPlane(const glm::dvec3& normal, double distance) {
+            Quadric q;
+            q.a00 = normal.x * normal.x; q.a01 = normal.x * normal.y; q.a02 = normal.x * normal.z; q.a03 = normal.x * distance;
+            q.a11 = normal.y * normal.y; q.a12 = normal.y * normal.z; q.a13 = normal.y * distance;
+            q.a22 = normal.z * normal.z; q.a23 = normal.z * distance;
+            q.a33 = distance * distance;
+            return q;
+        }
+
+        void add(const Quadric& other) {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+        }
+
+        // Sum of squared distances from the point to every plane accumulated so far
+        double evaluate(const glm::vec3& point) const {
+            double x = point.x, y = point.y, z = point.z;
+            double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                          + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                          + a22 * z * z + 2 * a23 * z
+                          + a33;
+            return std::max(result, 0.0);
+        }
+    };
+
+    struct Collapse {
+        double cost;
+        unsigned int from, to;
+        unsigned int fromVersion, toVersion;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    uint64_t edgeKey(unsigned int a, unsigned int b) {
+        if (a > b) std::swap(a, b);
+        return ((uint64_t) a << 32) | b;
+    }
+}
+
+std::vector<unsigned int> assets::simplifyMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices,
+                                               size_t indexCount, size_t targetIndexCount, float maxError,
+                                               float& resultError) {
+    resultError = 0.0f;
+    size_t triangleCount = indexCount / 3;
+    std::vector<unsigned int> triangles(indices, indices + triangleCount * 3);
+    std::vector<char> removed(triangleCount, 0);
+
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<unsigned int>> vertexTriangles(vertexCount);
+    std::unordered_map<uint64_t, unsigned int> edgeUses;
+
+    for (unsigned int t = 0; t < triangleCount; t++) {
+        const unsigned int* corner = &triangles[t * 3];
+        glm::dvec3 a = vertices[corner[0]].Position, b = vertices[corner[1]].Position, c = vertices[corner[2]].Position;
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if (length > 0.0) normal /= length;
+
+        Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, a));
+        for (int i = 0; i < 3; i++) {
+            quadrics[corner[i]].add(plane);
+            vertexTriangles[corner[i]].push_back(t);
+            edgeUses[edgeKey(corner[i], corner[(i + 1) % 3])]++;
+        }
+    }
+
+    // Vertices on borders or non-manifold edges can be collapsed onto, but never moved
+    std::vector<char> locked(vertexCount, 0);
+    for (const auto& [key, uses] : edgeUses) {
+        if (uses != 2) {
+            locked[key >> 32] = 1;
+            locked[key & 0xFFFFFFFF] = 1;
+        }
+    }
+
+    std::vector<unsigned int> version(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+
+    auto pushCollapse = [&](unsigned int from, unsigned int to) {
+        if (locked[from] || from == to) return;
+
+        Quadric combined = quadrics[from];
+        combined.add(quadrics[to]);
+        queue.push({combined.evaluate(vertices[to].Position), from, to, version[from], version[to]});
+    };
+
+    for (unsigned int t = 0; t < triangleCount; t++) {
+        for (int i = 0; i < 3; i++) {
+            pushCollapse(triangles[t * 3 + i], triangles[t * 3 + (i + 1) % 3]);
+            pushCollapse(triangles[t * 3 + (i + 1) % 3], triangles[t * 3 + i]);
+        }
+    }
+
+    // Moving `from` onto `to` must not flip any triangle that survives the collapse
+    auto flipsTriangle = [&](unsigned int from, unsigned int to) {
+        for (unsigned int t : vertexTriangles[from]) {
+            if (removed[t]) continue;
+
+            const unsigned int* corner = &triangles[t * 3];
+            if (corner[0] == to || corner[1] == to || corner[2] == to) continue;
+
+            glm::vec3 before[3], after[3];
+            for (int i = 0; i < 3; i++) {
+                before[i] = vertices[corner[i]].Position;
+                after[i] = corner[i] == from ? vertices[to].Position : before[i];
+            }
+
+            glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(normalBefore, normalAfter) <= 0.0f) return true;
+        }
+
+        return false;
+    };
+
+    double maxCost = (double) maxError * maxError;
+    size_t liveTriangles = triangleCount;
+
+    while (liveTriangles * 3 > targetIndexCount && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+
+        if (collapse.fromVersion != version[collapse.from] || collapse.toVersion != version[collapse.to]) continue;
+        if (collapse.cost > maxCost) break;
+        if (flipsTriangle(collapse.from, collapse.to)) continue;
+
+        unsigned int from = collapse.from, to = collapse.to;
+        for (unsigned int t : vertexTriangles[from]) {
+            if (removed[t]) continue;
+
+            unsigned int* corner = &triangles[t * 3];
+            if (corner[0] == to || corner[1] == to || corner[2] == to) {
+                removed[t] = 1;
+                liveTriangles--;
+                continue;
+            }
+
+            for (int i = 0; i < 3; i++) {
+                if (corner[i] == from) corner[i] = to;
+            }
+            vertexTriangles[to].push_back(t);
+        }
+        vertexTriangles[from].clear();
+
+        quadrics[to].add(quadrics[from]);
+        version[from]++;
+        version[to]++;
+        resultError = std::max(resultError, (float) std::sqrt(collapse.cost));
+
+        // Drop triangles that died and requeue every edge around the merged vertex
+        auto& around = vertexTriangles[to];
+        around.erase(std::remove_if(around.begin(), around.end(), [&](unsigned int t) { return removed[t]; }), around.end());
+        for (unsigned int t : around) {
+            for (int i = 0; i < 3; i++) {
+                unsigned int other = triangles[t * 3 + i];
+                if (other == to) continue;
+
+                version[other]++;
+                pushCollapse(other, to);
+                pushCollapse(to, other);
+            }
+        }
+        for (unsigned int t : around) {
+            for (int i = 0; i < 3; i++) {
+                unsigned int a = triangles[t * 3 + i], b = triangles[t * 3 + (i + 1) % 3];
+                if (a != to && b != to) {
+                    pushCollapse(a, b);
+                    pushCollapse(b, a);
+                }
+            }
+        }
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(liveTriangles * 3);
+    for (unsigned int t = 0; t < triangleCount; t++) {
+        if (!removed[t]) {
+            result.insert(result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+        }
+    }
+
+    return result;
+}
+
+size_t assets::generateLods(Mesh& mesh) {
+    mesh.lods.clear();
+    size_t fullIndexCount = mesh.indices.size();
+    if (fullIndexCount / 3 < MIN_LOD_TRIANGLES * 2) return 0;
+
+    mesh.lods.push_back({0, (uint32_t) fullIndexCount, 0.0f});
+    std::vector<unsigned int> current(mesh.indices.begin(), mesh.indices.end());
+    float error = 0.0f;
+
+    while (mesh.lods.size() < MAX_LOD_COUNT && current.size() / 3 >= MIN_LOD_TRIANGLES * 2) {
+        size_t target = (size_t) (current.size() / 3 * LOD_REDUCTION) * 3;
+
+        float levelError;
+        std::vector<unsigned int> simplified = simplifyMesh(mesh.vertices.data(), mesh.vertices.size(), current.data(),
+            current.size(), target, std::numeric_limits<float>::max(), levelError);
+
+        // Locked borders can stall the reduction, more levels would only repeat this one
+        if (simplified.empty() || simplified.size() > current.size() * 0.9f) break;
+
+        // Each level is simplified from the previous one, so deviations from the original add up
+        error += levelError;
+        optimizeVertexCache(simplified.data(), simplified.size(), mesh.vertices.size());
+
+        mesh.lods.push_back({(uint32_t) mesh.indices.size(), (uint32_t) simplified.size(), error});
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        current = std::move(simplified);
+    }
+
+    if (mesh.lods.size() == 1) {
+        mesh.lods.clear();
+    }
+    return mesh.lods.size();
+}
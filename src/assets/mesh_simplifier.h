@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "assets/mesh.h"
+
+namespace assets {
+
+// Including the full resolution mesh
+constexpr size_t MAX_LOD_COUNT = 5;
+// Each level aims for this fraction of the previous level's triangles
+constexpr float LOD_REDUCTION = 0.5f;
+// Meshes this small aren't worth another level
+constexpr size_t MIN_LOD_TRIANGLES = 64;
+
+// Quadric error edge collapse (Garland & Heckbert). Vertices only ever collapse onto an existing
+// neighbour, so the result indexes the same vertex buffer. Open borders, which after welding
+// include UV and normal seams, stay in place. Stops at targetIndexCount indices or when the next
+// collapse would move the surface by more than maxError. resultError receives the largest error used.
+std::vector<unsigned int> simplifyMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices,
+                                       size_t indexCount, size_t targetIndexCount, float maxError, float& resultError);
+
+// Appends simplified index buffers after the full one and fills mesh.lods. Leaves lods empty when
+// the mesh can't be reduced meaningfully. Expects Float32 vertices and 32 bit indices.
+size_t generateLods(Mesh& mesh);
+}
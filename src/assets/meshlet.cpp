@@ -0,0 +1,147 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    Meshlet computeMeshletBounds(const Vertex* vertices, const unsigned int* indices, size_t indexCount) {
+        Meshlet meshlet{};
+
+        glm::vec3 minPoint(INFINITY), maxPoint(-INFINITY);
+        for (size_t i = 0; i < indexCount; i++) {
+            minPoint = glm::min(minPoint, vertices[indices[i]].Position);
+            maxPoint = glm::max(maxPoint, vertices[indices[i]].Position);
+        }
+
+        meshlet.center = (minPoint + maxPoint) * 0.5f;
+        for (size_t i = 0; i < indexCount; i++) {
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].Position - meshlet.center));
+        }
+
+        std::vector<glm::vec3> normals;
+        glm::vec3 axis(0.0f);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            const glm::vec3& a = vertices[indices[i]].Position;
+            glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - a, vertices[indices[i + 2]].Position - a);
+            float length = glm::length(normal);
+            if (length == 0.0f) continue;
+
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+
+        meshlet.coneCutoff = 1.0f;
+        meshlet.coneApex = meshlet.center;
+        if (glm::length(axis) == 0.0f) {
+            return meshlet;
+        }
+        axis = glm::normalize(axis);
+
+        float minDot = 1.0f;
+        for (const glm::vec3& normal : normals) {
+            minDot = std::min(minDot, glm::dot(normal, axis));
+        }
+        // Cones wider than about 84 degrees almost never cull anything
+        if (minDot <= 0.1f) {
+            return meshlet;
+        }
+
+        // Move the apex back along the axis until every triangle's plane is in front of it
+        float maxDistance = 0.0f;
+        size_t normalIndex = 0;
+        for (size_t i = 0; i < indexCount; i += 3) {
+            const glm::vec3& a = vertices[indices[i]].Position;
+            glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - a, vertices[indices[i + 2]].Position - a);
+            if (glm::length(normal) == 0.0f) continue;
+
+            const glm::vec3& unitNormal = normals[normalIndex++];
+            float distance = glm::dot(meshlet.center - a, unitNormal) / glm::dot(axis, unitNormal);
+            maxDistance = std::max(maxDistance, distance);
+        }
+
+        meshlet.coneApex = meshlet.center - axis * maxDistance;
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        return meshlet;
+    }
+}
+
+std::vector<Meshlet> assets::buildMeshlets(const Vertex* vertices, size_t vertexCount, const unsigned int* indices,
+                                           size_t indexCount) {
+    std::vector<Meshlet> meshlets;
+
+    // Vertex to the meshlet that last used it, so unique vertices are counted without a set
+    std::vector<size_t> lastMeshlet(vertexCount, ~size_t(0));
+    size_t start = 0, meshletVertices = 0;
+
+    auto finishMeshlet = [&](size_t end) {
+        Meshlet meshlet = computeMeshletBounds(vertices, indices + start, end - start);
+        meshlet.indexOffset = (uint32_t) start;
+        meshlet.indexCount = (uint32_t) (end - start);
+        meshlets.push_back(meshlet);
+        start = end;
+        meshletVertices = 0;
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        size_t newVertices = 0;
+        for (size_t j = 0; j < 3; j++) {
+            unsigned int vertex = indices[i + j];
+            bool duplicate = (j > 0 && indices[i] == vertex) || (j > 1 && indices[i + 1] == vertex);
+            if (lastMeshlet[vertex] != meshlets.size() && !duplicate) newVertices++;
+        }
+
+        if (meshletVertices + newVertices > MAX_MESHLET_VERTICES || (i - start) / 3 >= MAX_MESHLET_TRIANGLES) {
+            finishMeshlet(i);
+        }
+
+        for (size_t j = 0; j < 3; j++) {
+            unsigned int vertex = indices[i + j];
+            if (lastMeshlet[vertex] != meshlets.size()) {
+                lastMeshlet[vertex] = meshlets.size();
+                meshletVertices++;
+            }
+        }
+    }
+
+    if (start < indexCount - indexCount % 3) {
+        finishMeshlet(indexCount - indexCount % 3);
+    }
+    return meshlets;
+}
+
+void assets::extractFrustumPlanes(const glm::mat4& clipFromModel, glm::vec4 planes[6]) {
+    glm::mat4 rows = glm::transpose(clipFromModel);
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+
+    for (int i = 0; i < 6; i++) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+void assets::cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::vec4 planes[6],
+                          const glm::vec3& cameraPosition, std::vector<IndexRange>& visible) {
+    for (const Meshlet& meshlet : meshlets) {
+        bool outside = false;
+        for (int i = 0; i < 6 && !outside; i++) {
+            outside = glm::dot(glm::vec3(planes[i]), meshlet.center) + planes[i].w < -meshlet.radius;
+        }
+        if (outside) continue;
+
+        glm::vec3 toApex = meshlet.coneApex - cameraPosition;
+        float distance = glm::length(toApex);
+        if (distance > 0.0f && glm::dot(toApex / distance, meshlet.coneAxis) >= meshlet.coneCutoff) continue;
+
+        if (!visible.empty() && visible.back().offset + visible.back().count == meshlet.indexOffset) {
+            visible.back().count += meshlet.indexCount;
+        }
+        else {
+            visible.push_back({meshlet.indexOffset, meshlet.indexCount});
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "assets/mesh.h"
+
+namespace assets {
+
+constexpr size_t MAX_MESHLET_VERTICES = 64;
+constexpr size_t MAX_MESHLET_TRIANGLES = 124;
+
+// Range of an index buffer to draw
+struct IndexRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// Cuts the index buffer into consecutive meshlets without reordering it, so the vertex cache
+// order from optimizeVertexCache is kept and a meshlet is just a range of indices.
+std::vector<Meshlet> buildMeshlets(const Vertex* vertices, size_t vertexCount, const unsigned int* indices,
+                                   size_t indexCount);
+
+// Normalized planes, inside where dot(plane.xyz, p) + plane.w >= 0. Pass projection * view * model
+// to get the planes in model space.
+void extractFrustumPlanes(const glm::mat4& clipFromModel, glm::vec4 planes[6]);
+
+// Appends the ranges of every meshlet that is inside the frustum and not facing away from the camera,
+// merging neighbouring ranges. Planes and camera position are in the mesh's model space.
+void cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::vec4 planes[6], const glm::vec3& cameraPosition,
+                  std::vector<IndexRange>& visible);
+}
@@ -1,6 +1,11 @@
 #include "model.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <sstream>
+#include <thread>
 
 #include "stb_image.h"
 
@@ -9,119 +14,785 @@
 #include <assimp/postprocess.h>
 
 #include "utils/paths.h"
+#include "assets/asset_pack.h"
+#include "assets/mesh_optimizer.h"
+#include "assets/mesh_simplifier.h"
+#include "assets/meshlet.h"
+#include "core/job_system.h"
+#include "utils/bounded_queue.h"
 
-Model::Model() = default;
+ModelResource::ModelResource() = default;
 
-Model::Model(std::string path, FileType type) {
+namespace {
+    std::atomic<size_t> totalGeometryBytes = 0, totalReleasedBytes = 0;
+
+    unsigned int importerFlagsFor(FileType type) {
+        int fileTypeInfo[2] = {
+            aiProcess_ConvertToLeftHanded, 0
+        };
+        return aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
+               fileTypeInfo[type];
+    }
+
+    // The model file plus the files it pulls geometry and materials from (glTF buffers, OBJ libraries)
+    std::vector<assets::SourceFile> collectModelSources(const std::string& modelPath) {
+        std::vector<std::string> paths = {modelPath};
+
+        std::filesystem::path directory = std::filesystem::path(modelPath).parent_path();
+        std::error_code error;
+        for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+            std::string extension = file.path().extension().string();
+            if (extension == ".bin" || extension == ".mtl") {
+                paths.push_back(file.path().generic_string());
+            }
+        }
+        std::sort(paths.begin() + 1, paths.end());
+
+        std::vector<assets::SourceFile> sources(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!assets::recordSourceFile(paths[i], sources[i])) {
+                std::cout << "Could not read model source " << paths[i] << "\n";
+            }
+        }
+        return sources;
+    }
+
+    uint64_t hashMesh(const Mesh& mesh) {
+        uint64_t hash = assets::hashBytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        return assets::hashBytes(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int), hash);
+    }
+
+    AnimationClip convertAnimation(const aiAnimation* animation) {
+        AnimationClip clip;
+        clip.name = animation->mName.C_Str();
+        clip.duration = animation->mDuration;
+        if (animation->mTicksPerSecond != 0) clip.ticksPerSecond = animation->mTicksPerSecond;
+
+        for (unsigned int i = 0; i < animation->mNumChannels; i++) {
+            const aiNodeAnim* nodeAnim = animation->mChannels[i];
+
+            NodeChannel channel;
+            channel.nodeName = nodeAnim->mNodeName.C_Str();
+            for (unsigned int j = 0; j < nodeAnim->mNumPositionKeys; j++) {
+                const aiVectorKey& key = nodeAnim->mPositionKeys[j];
+                channel.positions.push_back({(float) key.mTime, glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            for (unsigned int j = 0; j < nodeAnim->mNumRotationKeys; j++) {
+                const aiQuatKey& key = nodeAnim->mRotationKeys[j];
+                glm::quat rotation(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z);
+                channel.rotations.push_back({(float) key.mTime, rotation});
+            }
+            for (unsigned int j = 0; j < nodeAnim->mNumScalingKeys; j++) {
+                const aiVectorKey& key = nodeAnim->mScalingKeys[j];
+                channel.scales.push_back({(float) key.mTime, glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            clip.channels.push_back(std::move(channel));
+        }
+        return clip;
+    }
+
+    bool openAssetCache(const std::string& assetPackPath, AssetConverter& converter, AssetCache& cache) {
+        if (!cache.pack.open(assetPackPath)) {
+            std::cout << "Asset pack is invalid, reimporting: " << assetPackPath << "\n";
+            return false;
+        }
+
+        const assets::PackEntry* infoEntry = cache.pack.find(assets::PackEntryType::Info, 0);
+        assets::AssetFileView file;
+        if (infoEntry == nullptr || !cache.pack.view(*infoEntry, file)) {
+            return false;
+        }
+
+        cache.info = converter.convertBinaryToModelAssetInfo(file);
+        return true;
+    }
+}
+
+ModelSource ModelResource::defaultSource(const std::string& path, FileType type, const std::string& objectsPath,
+                                         const std::string& assetsPath) {
     size_t beginningOfPath = path.find_last_of('/');
+    if (beginningOfPath == std::string::npos) beginningOfPath = 0;
     size_t endOfPath = path.find('.');
     std::string nameOfModel = path.substr(beginningOfPath, endOfPath - beginningOfPath);
 
+    ModelSource source;
+    source.path = objectsPath + path;
+    source.type = type;
+    source.assetFolderPath = assetsPath + nameOfModel;
+    source.assetPackPath = source.assetFolderPath + ".pack";
+    source.bake = std::filesystem::exists(assetsPath);
+    return source;
+}
+
+ModelResource::ModelResource(std::string path, FileType type) : ModelResource(defaultSource(path, type)) {}
+
+ModelResource::ModelResource(const ModelSource& source) {
     auto startTime = std::chrono::high_resolution_clock::now();
-    std::string assetFolderPath = ASSET_PATH + nameOfModel;
-    if (std::filesystem::exists(assetFolderPath)) {
-        loadFromAsset(assetFolderPath);
-    } else {
-        std::string normalObjectPath = OBJECT_PATH + path;
-        loadInfo(normalObjectPath, type);
+    const std::string& assetPackPath = source.assetPackPath;
+
+    sourcePath = source.path;
+    directory = sourcePath.substr(0, sourcePath.find_last_of('/'));
+    importerFlags = importerFlagsFor(source.type);
+    asset_converter.codecs = source.codecs;
 
-        if (std::filesystem::exists(ASSET_PATH))
-        {
-            saveToAsset(assetFolderPath);
+    AssetCache cache;
+    bool hasCache = std::filesystem::exists(assetPackPath) &&
+                    openAssetCache(assetPackPath, asset_converter, cache);
+
+    bool loadedFromAsset = false;
+    bool texturesChanged = false;
+    if (hasCache) {
+        if (!areMeshesCurrent(cache.info)) {
+            std::cout << "Model sources changed since " << assetPackPath << " was baked, reimporting\n";
+        }
+        else if (source.bakeOnly && !areCodecsCurrent(cache.pack)) {
+            // Loading reads any codec, only bakes bring the pack to the requested ones
+            std::cout << assetPackPath << " was baked with other codecs, rebaking\n";
+        }
+        else if (source.bakeOnly && areTexturesCurrent(cache.info)) {
+            // Nothing to rebuild, and nothing to load it for
+            bake_report.success = true;
+            return;
         }
+        else {
+            loadedFromAsset = loadFromAsset(cache, texturesChanged);
+        }
+    } else if (!source.assetFolderPath.empty() && std::filesystem::exists(source.assetFolderPath)) {
+        // Folders hold no nodes, materials or clips, so the model is reimported and baked into a pack
+        std::cout << source.assetFolderPath << " was written by an older build, reimporting\n";
+    }
+
+    if (!loadedFromAsset) {
+        meshes.clear();
+        meshSourceHashes.clear();
+        textures_loaded.clear();
+        texture_sources.clear();
+        texture_handles.clear();
+        nodes.clear();
+        materials_loaded.clear();
+        animations.clear();
+        animation_clips.clear();
+        numAnimations = 0;
+        aabb = {};
+
+        loadInfo(sourcePath, source.type, hasCache ? &cache : nullptr);
+    }
+
+    // Node names are matched to channels and bones once here instead of every frame
+    for (AnimationClip& clip : animation_clips) {
+        bindClip(clip, nodes);
+    }
+    for (Animation& animation : animations) {
+        animation.bindSkeleton(nodes);
+    }
+
+    if ((!loadedFromAsset || texturesChanged) && source.bake && !meshes.empty())
+    {
+        saveToAsset(assetPackPath, hasCache ? &cache : nullptr);
+    }
+    if (std::filesystem::exists(assetPackPath)) {
+        asset_pack_path = assetPackPath;
     }
     auto endTime = std::chrono::high_resolution_clock::now();
     double elapsedTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
 
     std::cout << "Elapsed Time to load model data: " << elapsedTime << " ms\n";
-    model_matrix = glm::mat4(1.0f);
+
+    countedGeometryBytes = cpuGeometryBytes();
+    totalGeometryBytes += countedGeometryBytes;
 }
 
-void Model::loadInfo(std::string path, FileType type) {
-    int fileTypeInfo[2] = {
-        aiProcess_ConvertToLeftHanded, 0
-    };
-    const unsigned int importerFlags =
-            aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
-            fileTypeInfo[type];
+ModelResource::~ModelResource() {
+    totalGeometryBytes -= countedGeometryBytes;
+    totalReleasedBytes -= countedReleasedBytes;
+}
+
+void ModelResource::releaseGeometry() {
+    if (geometry_residency == GeometryResidency::Keep) return;
+
+    for (Mesh& mesh : meshes) {
+        if (mesh.residency != GeometryResidency::Keep) continue;
+
+        if (geometry_residency == GeometryResidency::PositionsOnly) {
+            mesh.positions.resize(mesh.vertexCount());
+            if (mesh.vertexFormat == assets::VertexFormat::Quantized16) {
+                glm::vec3 scale = assets::quantizationScale(mesh.aabb) / 65535.0f;
+                glm::vec3 offset = assets::quantizationOffset(mesh.aabb);
+                auto* packed = reinterpret_cast<const assets::PackedVertex*>(mesh.packedVertices.data());
+                for (size_t i = 0; i < mesh.positions.size(); i++) {
+                    glm::vec3 position(packed[i].position[0], packed[i].position[1], packed[i].position[2]);
+                    mesh.positions[i] = position * scale + offset;
+                }
+            }
+            else {
+                for (size_t i = 0; i < mesh.positions.size(); i++) mesh.positions[i] = mesh.vertices[i].Position;
+            }
+        }
+        else {
+            mesh.gpuIndexCount = mesh.indexCount();
+            mesh.gpuVertexCount = mesh.vertexCount();
+            std::vector<unsigned int>().swap(mesh.indices);
+            std::vector<uint16_t>().swap(mesh.shortIndices);
+        }
+
+        std::vector<Vertex>().swap(mesh.vertices);
+        std::vector<char>().swap(mesh.packedVertices);
+        mesh.residency = geometry_residency;
+    }
+
+    // Already in the animation SSBOs
+    for (Animation& animation : animations) {
+        std::vector<VertexBoneData>().swap(animation.bone_data);
+    }
+
+    size_t remaining = cpuGeometryBytes();
+    countedReleasedBytes += countedGeometryBytes - remaining;
+    totalReleasedBytes += countedGeometryBytes - remaining;
+    totalGeometryBytes -= countedGeometryBytes - remaining;
+    countedGeometryBytes = remaining;
+}
+
+size_t ModelResource::cpuGeometryBytes() const {
+    size_t bytes = 0;
+    for (const Mesh& mesh : meshes) {
+        bytes += mesh.cpuBytes();
+    }
+    for (const Animation& animation : animations) {
+        bytes += animation.bone_data.size() * sizeof(VertexBoneData);
+    }
+    return bytes;
+}
+
+size_t ModelResource::residentGeometryBytes() {
+    return totalGeometryBytes;
+}
+
+size_t ModelResource::releasedGeometryBytes() {
+    return totalReleasedBytes;
+}
+
+void ModelResource::loadInfo(std::string path, FileType type, const AssetCache* cache) {
     Assimp::Importer importer;
-    scene = importer.ReadFile(path, importerFlags);
+    const aiScene* scene = importer.ReadFile(path, importerFlags);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
         return;
     }
     directory = path.substr(0, path.find_last_of('/'));
-    numAnimations = scene->mNumAnimations;
 
-    processMaterials(scene);
+    processMaterials(scene, cache);
 
     processNode(scene->mRootNode, scene);
-    scene = importer.GetOrphanedScene();
+
+    // Copied out so the scene can go with the importer
+    for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
+        animation_clips.push_back(convertAnimation(scene->mAnimations[i]));
+    }
+    numAnimations = animation_clips.size();
 }
 
-void Model::saveToAsset(const std::string& assetFolderPath) {
-    std::filesystem::create_directory(assetFolderPath);
+bool ModelResource::areMeshesCurrent(const ModelAssetInfo& info) const {
+    if (info.converterVersion != AssetConverter::VERSION || info.importerFlags != importerFlags ||
+        info.sources.empty() || info.sources[0].path != sourcePath) {
+        return false;
+    }
+
+    for (const assets::SourceFile& source : info.sources) {
+        if (!assets::isSourceUnchanged(source)) return false;
+    }
+
+    return true;
+}
+
+bool ModelResource::areTexturesCurrent(const ModelAssetInfo& info) const {
+    for (const TextureSource& texture : info.textures) {
+        if (!assets::isSourceUnchanged(texture.file)) return false;
+    }
+    return true;
+}
+
+bool ModelResource::areCodecsCurrent(const assets::PackReader& pack) const {
+    for (const assets::PackEntry& entry : pack.getEntries()) {
+        if (!isCodecCurrent(entry)) return false;
+    }
+    return true;
+}
+
+bool ModelResource::isCodecCurrent(const assets::PackEntry& entry) const {
+    assets::CodecSettings codec = asset_converter.codecs.forEntry(entry.type);
+    return entry.codec == codec.codec && entry.codecLevel == (uint32_t) assets::resolvedCodecLevel(codec);
+}
+
+bool ModelResource::isEntryCurrent(const assets::PackEntry* entry, uint64_t sourceHash, bool dependsOnImport) const {
+    return entry != nullptr && entry->sourceHash == sourceHash && isCodecCurrent(*entry) &&
+           entry->converterVersion == AssetConverter::VERSION &&
+           (!dependsOnImport || entry->importerFlags == importerFlags);
+}
+
+uint64_t ModelResource::textureKey(const assets::SourceFile& source, const std::string& type, bool baked) const {
+    uint64_t bakeSettings = 0;
+    if (baked) {
+        bakeSettings = (uint64_t) AssetConverter::VERSION << 32 | (uint64_t) asset_converter.mipFilter << 2 |
+                       (uint64_t) asset_converter.generateMips << 1 | (uint64_t) asset_converter.compressTextures;
+    }
+    return assets::textureContentKey(source.hash, type, bakeSettings);
+}
+
+namespace {
+    // Compressed assets waiting for the writer. Bounds how much baked data sits in memory
+    // when compression outpaces the disk.
+    constexpr size_t WRITE_QUEUE_CAPACITY = 8;
+
+    struct BakedAsset {
+        assets::PackEntry entry;
+        assets::AssetFile file;
+        // Set when an unchanged payload is copied from the previous pack instead of being rebuilt
+        const char* reusedPayload;
+        size_t storedSize;
+        double bakeTime;
+        std::string details;
+    };
+}
+
+void ModelResource::saveToAsset(const std::string& assetPackPath, AssetCache* cache) {
+    // The previous pack stays mapped while unchanged entries are copied out of it
+    std::string temporaryPath = assetPackPath + ".tmp";
+
+    assets::PackWriter writer;
+    if (!writer.open(temporaryPath)) {
+        std::cout << "Could not create asset pack at " << assetPackPath << "\n";
+        return;
+    }
 
     ModelAssetInfo info;
     info.numMeshes = meshes.size();
     info.numTexture = textures_loaded.size();
+    info.importerFlags = importerFlags;
+    info.converterVersion = AssetConverter::VERSION;
+    info.sources = collectModelSources(sourcePath);
+    for (auto&[path, texture]: textures_loaded) {
+        info.textures.push_back({path, texture.type, texture_sources[path]});
+    }
 
     assets::AssetFile file = asset_converter.convertModelAssetInfoToBinary(info);
-    std::string mainFilePath = assetFolderPath + "/main.object";
-    assets::saveBinaryFile(mainFilePath, file);
+    bool saveSuccessful = writer.add(assets::PackEntryType::Info, 0, file);
+
+    // Cheap next to the meshes, so it is rebuilt on every save instead of being reused
+    assets::AssetFile sceneFile = asset_converter.convertSceneToBinary(sceneForBake());
+    saveSuccessful = writer.add(assets::PackEntryType::Scene, 0, sceneFile) && saveSuccessful;
 
-    std::string meshFolderPath = assetFolderPath + "/meshes";
-    std::string textureFolderPath = assetFolderPath + "/textures";
-    std::filesystem::create_directory(meshFolderPath);
-    std::filesystem::create_directory(textureFolderPath);
+    // Assets are compressed as jobs and written by one thread as they finish
+    BoundedQueue<BakedAsset> writeQueue(WRITE_QUEUE_CAPACITY);
+    std::vector<BakedAsset> written;
 
-    int i = 0;
-    for (Mesh&mesh: meshes) {
-        auto file = asset_converter.convertMeshToBinary(mesh);
-        std::string assetPath = assetFolderPath + "/meshes/mesh" + std::to_string(i) + ".object";
-        i++;
-        bool saveSuccessful = assets::saveBinaryFile(assetPath, file);
-        if (!saveSuccessful) {
-            std::cout << "Error occured while saving mesh \n";
+    std::thread writerThread([&]() {
+        BakedAsset asset;
+        while (writeQueue.pop(asset)) {
+            bool added = asset.reusedPayload != nullptr ?
+                writer.addCopy(asset.entry, asset.reusedPayload) : writer.add(asset.entry, asset.file);
+            saveSuccessful = added && saveSuccessful;
+
+            // Only the sizes are needed for the report
+            asset.file.binaryBlob.clear();
+            asset.file.binaryBlob.shrink_to_fit();
+            written.push_back(std::move(asset));
         }
+    });
+
+    JobSystem& jobs = JobSystem::shared();
+    std::vector<JobSystem::JobHandle> bakeTasks;
+
+    auto bake = [&](assets::PackEntry entry, bool dependsOnImport, auto convert) {
+        const assets::PackEntry* cached = nullptr;
+        if (cache != nullptr) {
+            cached = entry.type == assets::PackEntryType::Texture ?
+                cache->pack.findByKey(entry.type, entry.sourceKey) : cache->pack.find(entry.type, entry.index);
+        }
+
+        if (isEntryCurrent(cached, entry.sourceHash, dependsOnImport)) {
+            assets::PackEntry reused = *cached;
+            reused.index = entry.index;
+
+            assets::AssetFile emptyFile;
+            emptyFile.rawBlobSize = reused.uncompressedSize;
+            writeQueue.push({reused, std::move(emptyFile), cache->pack.payload(*cached), reused.size, 0.0, ""});
+            return;
+        }
+
+        std::string details;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        assets::AssetFile file = convert(details);
+        auto endTime = std::chrono::high_resolution_clock::now();
+
+        double bakeTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+        size_t storedSize = file.binaryBlob.size();
+        writeQueue.push({entry, std::move(file), nullptr, storedSize, bakeTime, std::move(details)});
+    };
+
+    for (uint32_t i = 0; i < meshes.size(); i++) {
+        bakeTasks.push_back(jobs.schedule([&, i]() {
+            assets::PackEntry entry{};
+            entry.type = assets::PackEntryType::Mesh;
+            entry.index = i;
+            entry.importerFlags = importerFlags;
+            entry.sourceKey = i;
+            entry.sourceHash = meshSourceHashes[i];
+            entry.converterVersion = AssetConverter::VERSION;
+
+            bake(entry, true, [&](std::string& details) {
+                if (meshes[i].vertexFormat == assets::VertexFormat::Float32) {
+                    details = prepareMeshForBake(i);
+                }
+                return asset_converter.convertMeshToBinary(meshes[i]);
+            });
+
+            // Weights follow the vertex order prepareMeshForBake leaves, so they are baked after the
+            // mesh and reused along with it
+            if (i < animations.size() && !animations[i].bone_info.empty()) {
+                entry.type = assets::PackEntryType::Skin;
+                bake(entry, true, [&](std::string& details) {
+                    return asset_converter.convertSkinToBinary(animations[i]);
+                });
+            }
+        }));
     }
 
-    i = 0;
+    uint32_t textureIndex = 0;
     for (auto&[path, texture]: textures_loaded) {
-        auto file = asset_converter.convertTextureToBinary(texture);
+        assets::PackEntry entry{};
+        entry.type = assets::PackEntryType::Texture;
+        entry.index = textureIndex++;
+        entry.importerFlags = importerFlags;
+        entry.sourceKey = assets::hashString(path);
+        entry.sourceHash = texture_sources[path].hash;
+        entry.converterVersion = AssetConverter::VERSION;
+
+        Texture* texturePtr = &texture;
+        uint64_t bakedKey = textureKey(texture_sources[path], texture.type, true);
+        bakeTasks.push_back(jobs.schedule([&, entry, texturePtr, bakedKey]() {
+            bake(entry, false, [&](std::string& details) {
+                Texture& texture = *texturePtr;
+                if (asset_converter.generateMips && texture.mipLevels == 1 && texture.compression == TextureCompression::None &&
+                    assets::generateMips(texture, asset_converter.mipFilter)) {
+                    details = std::to_string(texture.mipLevels) + " " +
+                        assets::mipFilterName(asset_converter.mipFilter) + " filtered mip levels";
+                }
+                if (asset_converter.compressTextures && texture.compression == TextureCompression::None &&
+                    assets::compressTexture(texture, assets::chooseTextureCompression(texture))) {
+                    details += (details.empty() ? "" : ", ") + std::string(assets::textureCompressionName(texture.compression));
+                }
+                // What gets uploaded is the baked texture now
+                texture.contentKey = bakedKey;
+                return asset_converter.convertTextureToBinary(texture);
+            });
+        }));
+    }
+
+    jobs.wait(bakeTasks);
+    writeQueue.close();
+    writerThread.join();
+
+    std::sort(written.begin(), written.end(), [](const BakedAsset& a, const BakedAsset& b) {
+        return a.entry.type != b.entry.type ? a.entry.type < b.entry.type : a.entry.index < b.entry.index;
+    });
 
-        std::string assetPath = assetFolderPath + "/textures/texture" + std::to_string(i) + ".object";
-        i++;
-        bool saveSuccessful = assets::saveBinaryFile(assetPath, file);
-        if (!saveSuccessful) {
-            std::cout << "Error occured while saving texture \n";
+    bake_report = {};
+    bake_report.baked = true;
+
+    size_t totalRaw = 0, totalStored = 0, reusedCount = 0;
+    for (BakedAsset& asset : written) {
+        const char* typeName = assets::packEntryTypeName(asset.entry.type);
+        totalRaw += asset.file.rawBlobSize;
+        totalStored += asset.storedSize;
+        bake_report.entries.push_back({asset.entry.type, asset.entry.index, asset.bakeTime, asset.file.rawBlobSize,
+                                       asset.storedSize, asset.reusedPayload != nullptr, asset.details});
+
+        if (asset.reusedPayload != nullptr) {
+            reusedCount++;
+            std::cout << "Reused " << typeName << asset.entry.index << ": unchanged\n";
+            continue;
+        }
+
+        std::cout << "Baked " << typeName << asset.entry.index << ": " << asset.bakeTime << " ms, "
+            << asset.file.rawBlobSize << " -> " << asset.storedSize << " bytes";
+        if (asset.storedSize > 0) {
+            std::cout << " (ratio " << (double) asset.file.rawBlobSize / asset.storedSize << ")";
+        }
+        if (!asset.details.empty()) {
+            std::cout << ", " << asset.details;
         }
+        std::cout << "\n";
+    }
+    std::cout << "Baked " << written.size() - reusedCount << " assets and reused " << reusedCount
+        << " on " << jobs.size() + 1 << " threads, " << totalRaw << " -> " << totalStored << " bytes\n";
+
+    saveSuccessful = writer.finish() && saveSuccessful;
+
+    // Unmap the old pack before replacing it, Windows refuses to overwrite mapped files
+    if (cache != nullptr) {
+        cache->pack.close();
+    }
+
+    std::error_code error;
+    if (saveSuccessful) {
+        std::filesystem::rename(temporaryPath, assetPackPath, error);
+    }
+    bake_report.success = saveSuccessful && !error;
+    if (!saveSuccessful || error) {
+        std::cout << "Error occured while saving asset pack \n";
+        std::filesystem::remove(temporaryPath, error);
+        std::filesystem::remove(assetPackPath, error);
     }
 }
 
-void Model::loadFromAsset(const std::string&assetFolderPath) {
-    std::string modelInfoPath = assetFolderPath + "/main.object";
-    ModelAssetInfo info = asset_converter.convertBinaryToModelAssetInfo(modelInfoPath);
+std::string ModelResource::prepareMeshForBake(size_t index) {
+    Mesh& mesh = meshes[index];
+    // Already prepared by an earlier save, the index buffer holds every level
+    if (!mesh.lods.empty() || !mesh.meshlets.empty()) {
+        return "";
+    }
 
-    for (int i = 0; i < info.numMeshes; i++) {
-        std::string meshAssetPath = assetFolderPath + "/meshes/mesh" + std::to_string(i) + ".object";
-        Mesh mesh = asset_converter.convertBinaryToMesh(meshAssetPath);
-        meshes.push_back(mesh);
+    std::ostringstream details;
+    details.precision(3);
+
+    if (asset_converter.optimizeMeshes) {
+        // Skinned vertices only weld when their bone weights match too, and the weights follow the new order
+        std::vector<VertexBoneData>* boneData = nullptr;
+        if (index < animations.size() && animations[index].bone_data.size() == mesh.vertices.size()) {
+            boneData = &animations[index].bone_data;
+        }
+
+        std::vector<unsigned int> remap;
+        assets::MeshOptimizationReport report = assets::optimizeMesh(mesh, asset_converter.reorderForOverdraw, remap,
+            boneData ? boneData->data() : nullptr, sizeof(VertexBoneData));
+
+        if (boneData) {
+            std::vector<VertexBoneData> reordered(mesh.vertices.size());
+            for (size_t i = 0; i < remap.size(); i++) {
+                if (remap[i] != ~0u) reordered[remap[i]] = (*boneData)[i];
+            }
+            *boneData = std::move(reordered);
+        }
+
+        details << "ACMR " << report.before.acmr << " -> " << report.after.acmr
+            << ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+            << ", " << report.weldedVertices << " vertices welded";
+    }
+
+    // Built before the LODs are appended, meshlets only cover the full resolution level. Skinned meshes
+    // get none, their bounds and cones would come from the bind pose the shader deforms.
+    bool skinned = index < animations.size() && !animations[index].bone_data.empty();
+    if (asset_converter.generateMeshlets && !skinned) {
+        mesh.meshlets = assets::buildMeshlets(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(),
+            mesh.indices.size());
+        if (mesh.meshlets.size() < 2) {
+            mesh.meshlets.clear();
+        }
+        else {
+            details << (details.tellp() > 0 ? ", " : "") << mesh.meshlets.size() << " meshlets";
+        }
+    }
+
+    if (asset_converter.generateLods && assets::generateLods(mesh) > 0) {
+        details << (details.tellp() > 0 ? ", " : "") << "LOD triangles";
+        for (const MeshLod& lod : mesh.lods) {
+            details << " " << lod.indexCount / 3;
+        }
+        details << " (max error " << mesh.lods.back().error << ")";
+    }
+    return details.str();
+}
+
+bool ModelResource::loadFromAsset(const AssetCache& cache, bool& texturesChanged) {
+    const assets::PackReader& reader = cache.pack;
+    const ModelAssetInfo& info = cache.info;
+    if (info.textures.size() != (size_t) info.numTexture) {
+        return false;
+    }
+
+    // Packs without a scene can't be drawn without the importer
+    const assets::PackEntry* sceneEntry = reader.find(assets::PackEntryType::Scene, 0);
+    if (sceneEntry == nullptr) {
+        return false;
     }
+    reader.prefetch(*sceneEntry);
 
+    std::vector<const assets::PackEntry*> meshEntries, textureEntries, skinEntries;
+    for (int i = 0; i < info.numMeshes; i++) {
+        meshEntries.push_back(reader.find(assets::PackEntryType::Mesh, i));
+        // Null for meshes without bones
+        skinEntries.push_back(reader.find(assets::PackEntryType::Skin, i));
+        if (skinEntries.back() != nullptr) reader.prefetch(*skinEntries.back());
+    }
     for (int i = 0; i < info.numTexture; i++) {
-        std::string textureAssetPath = assetFolderPath + "/textures/texture" + std::to_string(i) + ".object";
-        Texture texture = asset_converter.convertBinaryToTexture(textureAssetPath);
+        textureEntries.push_back(reader.find(assets::PackEntryType::Texture, i));
+    }
+
+    // Queue reads for the whole model before decoding anything
+    for (auto* entries : {&meshEntries, &textureEntries}) {
+        for (const assets::PackEntry* entry : *entries) {
+            if (entry == nullptr) return false;
+            reader.prefetch(*entry);
+        }
+    }
+
+    JobSystem& jobs = JobSystem::shared();
+    std::atomic<bool> failed = false;
+
+    std::vector<JobSystem::JobHandle> loadTasks;
+    ModelScene loadedScene;
+    loadTasks.push_back(jobs.schedule([&]() {
+        assets::AssetFileView sceneFile;
+        if (!reader.view(*sceneEntry, sceneFile) || !asset_converter.convertBinaryToScene(sceneFile, loadedScene)) {
+            failed = true;
+        }
+    }));
+
+    std::vector<Mesh> loadedMeshes(meshEntries.size());
+    std::vector<Animation> loadedSkins(meshEntries.size());
+    for (size_t i = 0; i < meshEntries.size(); i++) {
+        loadTasks.push_back(jobs.schedule([&, i]() {
+            assets::AssetFileView meshFile;
+            if (!reader.view(*meshEntries[i], meshFile)) {
+                failed = true;
+                return;
+            }
+            if (!asset_converter.convertBinaryToMesh(meshFile, loadedMeshes[i])) {
+                failed = true;
+                return;
+            }
+
+            assets::AssetFileView skinFile;
+            if (skinEntries[i] != nullptr &&
+                (!reader.view(*skinEntries[i], skinFile) || !asset_converter.convertBinaryToSkin(skinFile, loadedSkins[i]))) {
+                failed = true;
+            }
+        }));
+    }
+
+    // Textures whose image changed on disk are decoded from the image again and rebaked afterwards
+    std::vector<assets::SourceFile> textureSources(textureEntries.size());
+    std::vector<char> textureChanged(textureEntries.size(), 0);
+
+    std::vector<Texture> loadedTextures(textureEntries.size());
+    std::vector<assets::TextureHandle> sharedTextures(textureEntries.size());
+    for (size_t i = 0; i < textureEntries.size(); i++) {
+        loadTasks.push_back(jobs.schedule([&, i]() {
+            const TextureSource& source = info.textures[i];
+            textureSources[i] = source.file;
+
+            Texture& texture = loadedTextures[i];
+            uint64_t key = 0;
+            if (!assets::isSourceUnchanged(source.file)) {
+                textureChanged[i] = 1;
+                if (!assets::recordSourceFile(source.file.path, textureSources[i]) ||
+                    !textureFromFile(source.path.c_str(), directory, texture)) {
+                    failed = true;
+                }
+                texture.type = source.type;
+                key = textureKey(textureSources[i], source.type, false);
+            }
+            else {
+                // Already on the GPU for another model, nothing to decode
+                key = textureKey(source.file, source.type, true);
+                sharedTextures[i] = assets::TextureRegistry::shared().find(key);
+                if (sharedTextures[i]) {
+                    texture = sharedTextures[i]->texture;
+                }
+                else {
+                    assets::AssetFileView textureFile;
+                    if (!reader.view(*textureEntries[i], textureFile)) {
+                        failed = true;
+                        return;
+                    }
+                    if (!asset_converter.convertBinaryToTexture(textureFile, texture)) {
+                        failed = true;
+                    }
+                }
+            }
+
+            texture.path = source.path;
+            texture.contentKey = key;
+        }));
+    }
+    jobs.wait(loadTasks);
 
-        textures_loaded[textureAssetPath] = texture;
+    // Collected in index order so meshes and textures_loaded match the serial load
+    meshes.reserve(loadedMeshes.size());
+    for (size_t i = 0; i < loadedMeshes.size(); i++) {
+        meshes.push_back(std::move(loadedMeshes[i]));
+        meshSourceHashes.push_back(meshEntries[i]->sourceHash);
     }
+    animations = std::move(loadedSkins);
+    for (size_t i = 0; i < loadedTextures.size(); i++) {
+        const std::string& path = info.textures[i].path;
+        textures_loaded[path] = loadedTextures[i];
+        texture_sources[path] = textureSources[i];
+        if (sharedTextures[i]) texture_handles[path] = sharedTextures[i];
+
+        if (textureChanged[i]) {
+            std::cout << "Texture source changed: " << path << "\n";
+            texturesChanged = true;
+        }
+    }
+
+    return !failed && applyScene(loadedScene);
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene, int parentIndex) {
+ModelScene ModelResource::sceneForBake() const {
+    ModelScene scene;
+    scene.nodes = nodes;
+    for (const Material& material : materials_loaded) {
+        scene.materialTextures.push_back(material.texture_paths);
+    }
+    for (const Mesh& mesh : meshes) {
+        scene.meshMaterials.push_back(mesh.materialIndex);
+        scene.meshTransforms.push_back(mesh.model_matrix);
+    }
+    scene.clips = animation_clips;
+    return scene;
+}
+
+bool ModelResource::applyScene(ModelScene& scene) {
+    if (scene.meshMaterials.size() != meshes.size() || scene.meshTransforms.size() != meshes.size()) {
+        std::cout << "Scene of " << sourcePath << " doesn't match its meshes\n";
+        return false;
+    }
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        if (scene.meshMaterials[i] >= scene.materialTextures.size()) return false;
+        meshes[i].materialIndex = scene.meshMaterials[i];
+        meshes[i].model_matrix = scene.meshTransforms[i];
+
+        // The import computes this while reading vertices, baked meshes only have their own bounds
+        const BoundingBox& meshBounds = meshes[i].aabb;
+        if (!aabb.isInitialized) {
+            aabb.isInitialized = true;
+            aabb.minPoint = meshBounds.minPoint;
+            aabb.maxPoint = meshBounds.maxPoint;
+        }
+        else {
+            aabb.minPoint = glm::vec4(glm::min(glm::vec3(aabb.minPoint), glm::vec3(meshBounds.minPoint)), 1.0f);
+            aabb.maxPoint = glm::vec4(glm::max(glm::vec3(aabb.maxPoint), glm::vec3(meshBounds.maxPoint)), 1.0f);
+        }
+    }
+
+    nodes = std::move(scene.nodes);
+    materials_loaded.resize(scene.materialTextures.size());
+    for (size_t i = 0; i < materials_loaded.size(); i++) {
+        materials_loaded[i].texture_paths = std::move(scene.materialTextures[i]);
+    }
+    animation_clips = std::move(scene.clips);
+    numAnimations = animation_clips.size();
+    return true;
+}
+
+void ModelResource::processNode(aiNode* node, const aiScene* scene, int parentIndex) {
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
         meshes.push_back(processMesh(mesh, scene));
+        meshSourceHashes.push_back(hashMesh(meshes.back()));
     }
 
     NodeData data;
@@ -136,7 +807,7 @@ void Model::processNode(aiNode* node, const aiScene* scene, int parentIndex) {
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
+Mesh ModelResource::processMesh(aiMesh* mesh, const aiScene* scene) {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<std::string> textures;
@@ -263,7 +934,7 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
     return newMesh;
 }
 
-void Model::processMaterials(const aiScene* scene) {
+void ModelResource::processMaterials(const aiScene* scene, const AssetCache* cache) {
     std::vector<std::string> textures;
     materials_loaded.resize(scene->mNumMaterials);
 
@@ -281,15 +952,15 @@ void Model::processMaterials(const aiScene* scene) {
         aiMaterial* material = scene->mMaterials[i];
 
         for (auto& [aiTextureType, typeName] : textureTypes) {
-            auto foundTextures = loadMaterialTextures(material, aiTextureType, typeName);
+            auto foundTextures = loadMaterialTextures(scene, material, aiTextureType, typeName, cache);
             textures.insert(textures.end(), foundTextures.begin(), foundTextures.end());
         }
         materials_loaded[i].texture_paths = textures;
     }
 }
 
-std::vector<std::string> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type,
-                                                     std::string typeName) {
+std::vector<std::string> ModelResource::loadMaterialTextures(const aiScene* scene, aiMaterial* mat, aiTextureType type,
+                                                     std::string typeName, const AssetCache* cache) {
     std::vector<std::string> textures;
 
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
@@ -302,18 +973,56 @@ std::vector<std::string> Model::loadMaterialTextures(aiMaterial* mat, aiTextureT
             Texture texture;
             bool success = false;
 
+            // Embedded images have no file of their own, their bytes are hashed instead
+            assets::SourceFile source;
             const aiTexture* embeddedTexture = scene->GetEmbeddedTexture(str.C_Str());
             if (embeddedTexture) {
+                size_t embeddedSize = embeddedTexture->mHeight == 0 ?
+                    embeddedTexture->mWidth : embeddedTexture->mWidth * embeddedTexture->mHeight * sizeof(aiTexel);
+                source.hash = assets::hashBytes(embeddedTexture->pcData, embeddedSize);
+            }
+            else {
+                assets::recordSourceFile(directory + '/' + str.C_Str(), source);
+            }
+
+            // An unchanged image is decoded from the previous pack, which is much cheaper than the image codec.
+            // If another model already uploaded it, it isn't decoded at all: the rebake copies the entry as is.
+            if (cache != nullptr) {
+                const assets::PackEntry* cached = cache->pack.findByKey(assets::PackEntryType::Texture,
+                                                                        assets::hashString(str.C_Str()));
+                assets::AssetFileView textureFile;
+                if (isEntryCurrent(cached, source.hash, false)) {
+                    texture.contentKey = textureKey(source, typeName, true);
+                    if (assets::TextureHandle shared = assets::TextureRegistry::shared().find(texture.contentKey)) {
+                        texture = shared->texture;
+                        texture_handles[str.C_Str()] = shared;
+                        success = true;
+                    }
+                    // A corrupted entry counts as stale and the image is decoded below
+                    else if (cache->pack.view(*cached, textureFile) &&
+                             asset_converter.convertBinaryToTexture(textureFile, texture)) {
+                        texture.contentKey = textureKey(source, typeName, true);
+                        success = true;
+                    }
+                }
+            }
+
+            // Images without a pack entry have to be decoded for the bake even when the registry has them,
+            // only their upload is skipped
+            if (!success && embeddedTexture) {
                 success = textureFromMemory(embeddedTexture->pcData, embeddedTexture->mWidth, texture);
+                texture.contentKey = textureKey(source, typeName, false);
             }
             if (!success) {
                 success = textureFromFile(str.C_Str(), directory, texture);
+                texture.contentKey = textureKey(source, typeName, false);
             }
             if (success) {
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture.path);
                 textures_loaded[texture.path] = texture;
+                texture_sources[texture.path] = source;
             }
         }
         else {
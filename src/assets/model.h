@@ -4,13 +4,17 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
 #include "asset_converter.h"
+#include "asset_pack.h"
+#include "texture_registry.h"
 #include "mesh.h"
 #include "utils/material.h"
+#include "utils/paths.h"
 #include "assets/animation.h"
 
 enum FileType {
@@ -21,38 +25,142 @@ bool textureFromMemory(void* data, unsigned int bufferSize, Texture& texture);
 bool textureFromFile(const char *path, const std::string &directory, Texture& texture, bool gamma = false);
 glm::mat4 convertToGlmMatrix(const aiMatrix4x4& aiMat);
 
-class Model {
+// Where a model is imported from and where its baked pack lives
+struct ModelSource {
+    std::string path;
+    FileType type = OBJ;
+    std::string assetPackPath;
+    // Folder written by older builds. It is never loaded, the model is reimported and baked instead.
+    std::string assetFolderPath;
+    // Writes the pack when it is missing or stale
+    bool bake = true;
+    // Only brings the pack up to date. A current pack isn't read at all and leaves the model empty.
+    bool bakeOnly = false;
+    // Codecs entries are baked with. Packs with other codecs still load, only bakeOnly rebakes them.
+    BlobCodecs codecs;
+};
+
+// What the last save wrote, one entry per mesh and texture in the pack
+struct BakeReport {
+    struct Entry {
+        assets::PackEntryType type;
+        uint32_t index;
+        double bakeTime;
+        size_t rawSize, storedSize;
+        // Copied unchanged from the previous pack
+        bool reused;
+        std::string details;
+    };
+
+    // False when the pack was already current and nothing was written
+    bool baked = false;
+    bool success = false;
+    std::vector<Entry> entries;
+};
+
+// A pack from an earlier run. Entries whose inputs still match are reused instead of rebuilt.
+struct AssetCache {
+    assets::PackReader pack;
+    ModelAssetInfo info;
+};
+
+// Everything loaded for one model file: GPU buffers, CPU geometry, skeleton and materials. Shared by
+// every instance placed from it and only written while it loads, so it is never copied.
+class ModelResource {
     public:
         std::unordered_map<std::string, Texture> textures_loaded;
+        // Where each of textures_loaded was decoded from, so rebakes can skip unchanged textures
+        std::unordered_map<std::string, assets::SourceFile> texture_sources;
+        // Registry entries of textures_loaded, by the same paths. Textures found here at load time
+        // were never decoded and have no data.
+        std::unordered_map<std::string, assets::TextureHandle> texture_handles;
         std::vector<Mesh> meshes;
         std::vector<NodeData> nodes;
 
         std::vector<Material> materials_loaded;
+        // Skin of each mesh, empty for meshes without bones
         std::vector<Animation> animations;
+        std::vector<AnimationClip> animation_clips;
 
         std::string directory;
+        // Baked pack the model was loaded from or saved to, empty when there is none
+        std::string asset_pack_path;
         bool gammaCorrection;
-        glm::mat4 model_matrix;
         BoundingBox aabb;
-        bool shouldDraw = true;
         int numAnimations = 0;
 
-        const aiScene* scene;
         AssetConverter asset_converter;
+        // Applied by releaseGeometry once the meshes are uploaded
+        GeometryResidency geometry_residency = GeometryResidency::Keep;
+        BakeReport bake_report;
+
+        ModelResource();
+        // path is relative to OBJECT_PATH and the pack goes to ASSET_PATH, when that folder exists
+        explicit ModelResource(std::string path, FileType type = OBJ);
+        explicit ModelResource(const ModelSource& source);
+        ~ModelResource();
+
+        ModelResource(const ModelResource&) = delete;
+        ModelResource& operator=(const ModelResource&) = delete;
 
-        Model();
-        explicit Model(std::string path, FileType type = OBJ);
+        // Drops the CPU copies of vertices, indices and bone weights that geometry_residency doesn't keep.
+        // Only once nothing reads them any more, the GPU buffers are all drawing needs.
+        void releaseGeometry();
+        size_t cpuGeometryBytes() const;
+
+        // Where a model at objectsPath + path is baked to under assetsPath, the layout the demo loads from
+        static ModelSource defaultSource(const std::string& path, FileType type,
+                                         const std::string& objectsPath = OBJECT_PATH,
+                                         const std::string& assetsPath = ASSET_PATH);
+
+        // CPU geometry of every live resource, and how much releaseGeometry freed of it
+        static size_t residentGeometryBytes();
+        static size_t releasedGeometryBytes();
     private:
-        void loadInfo(std::string path, FileType type);
-        void loadFromAsset(const std::string& assetFolderPath);
-        void saveToAsset(const std::string& assetFolderPath);
+        std::string sourcePath;
+        unsigned int importerFlags = 0;
+        // Hash of each mesh as imported. Meshes read back from a pack may be packed and can't be rehashed.
+        std::vector<uint64_t> meshSourceHashes;
+        // This resource's share of the totals above
+        size_t countedGeometryBytes = 0, countedReleasedBytes = 0;
+
+        void loadInfo(std::string path, FileType type, const AssetCache* cache = nullptr);
+        bool loadFromAsset(const AssetCache& cache, bool& texturesChanged);
+        // Placement, materials and clips that aren't part of the mesh entries
+        ModelScene sceneForBake() const;
+        bool applyScene(ModelScene& scene);
+        void saveToAsset(const std::string& assetPackPath, AssetCache* cache = nullptr);
+
+        bool areMeshesCurrent(const ModelAssetInfo& info) const;
+        bool areTexturesCurrent(const ModelAssetInfo& info) const;
+        // Whether entries were stored with the codecs asset_converter bakes with
+        bool areCodecsCurrent(const assets::PackReader& pack) const;
+        bool isCodecCurrent(const assets::PackEntry& entry) const;
+        bool isEntryCurrent(const assets::PackEntry* entry, uint64_t sourceHash, bool dependsOnImport) const;
+        // Registry key of a texture decoded from a pack entry (baked) or straight from its image
+        uint64_t textureKey(const assets::SourceFile& source, const std::string& type, bool baked) const;
+        // Reorders a mesh for the GPU caches and builds its LODs before it is baked.
+        // Returns a summary for the bake report.
+        std::string prepareMeshForBake(size_t index);
 
         void processNode(aiNode *node, const aiScene *scene, int parentIndex = -1);
         Mesh processMesh(aiMesh *mesh, const aiScene *scene);
 
-    void processMaterials(const aiScene *scene);
+    void processMaterials(const aiScene *scene, const AssetCache* cache);
 
         void readNodeHierarchy(const aiNode* node, Mesh& mesh);
 
-        std::vector<std::string> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
-};
\ No newline at end of file
+        std::vector<std::string> loadMaterialTextures(const aiScene *scene, aiMaterial *mat, aiTextureType type, std::string typeName,
+                                                      const AssetCache* cache);
+};
+
+// One placement of a model in the scene, cheap enough to have thousands of
+struct ModelInstance {
+    std::shared_ptr<ModelResource> resource;
+
+    glm::mat4 model_matrix = glm::mat4(1.0f);
+    bool shouldDraw = true;
+    // Clip this instance plays and where in it, relative to the renderer's clock
+    int animation = 0;
+    float animationOffset = 0.0f;
+};
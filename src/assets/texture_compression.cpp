@@ -0,0 +1,470 @@
+#include "texture_compression.h"
+#include "texture_mips.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "core/job_system.h"
+
+namespace {
+    constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    struct BitWriter {
+        uint8_t* output;
+        int bit = 0;
+
+        void write(uint32_t value, int count) {
+            for (int i = 0; i < count; i++, bit++) {
+                if ((value >> i) & 1) output[bit >> 3] |= (uint8_t) (1 << (bit & 7));
+            }
+        }
+    };
+
+    void loadTexels(const uint8_t* rgba, glm::vec4* texels) {
+        for (int i = 0; i < 16; i++) {
+            texels[i] = glm::vec4(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2], rgba[i * 4 + 3]);
+        }
+    }
+
+    // Direction of largest spread through the texels' mean, by power iteration on their covariance.
+    // Only the first `channels` components take part.
+    glm::vec4 principalAxis(const glm::vec4* texels, int channels, glm::vec4& mean) {
+        glm::vec4 mask(1.0f, 1.0f, 1.0f, channels > 3 ? 1.0f : 0.0f);
+        mean = glm::vec4(0.0f);
+        for (int i = 0; i < 16; i++) mean += texels[i];
+        mean /= 16.0f;
+
+        glm::mat4 covariance(0.0f);
+        for (int i = 0; i < 16; i++) {
+            glm::vec4 d = (texels[i] - mean) * mask;
+            covariance += glm::outerProduct(d, d);
+        }
+
+        glm::vec4 axis(1.0f, 1.0f, 1.0f, channels > 3 ? 1.0f : 0.0f);
+        for (int iteration = 0; iteration < 8; iteration++) {
+            axis = covariance * axis;
+            float length = glm::length(axis);
+            if (length < 1e-6f) return glm::vec4(0.0f);
+            axis /= length;
+        }
+        return axis;
+    }
+
+    void axisExtents(const glm::vec4* texels, const glm::vec4& mean, const glm::vec4& axis, glm::vec4& low, glm::vec4& high) {
+        float minT = 0.0f, maxT = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            float t = glm::dot(texels[i] - mean, axis);
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        low = glm::clamp(mean + axis * minT, 0.0f, 255.0f);
+        high = glm::clamp(mean + axis * maxT, 0.0f, 255.0f);
+    }
+
+    // Endpoints minimizing the squared error for fixed interpolation weights (0 = first endpoint)
+    bool leastSquaresEndpoints(const glm::vec4* texels, const float* weights, glm::vec4& first, glm::vec4& second) {
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        glm::vec4 ax(0.0f), bx(0.0f);
+        for (int i = 0; i < 16; i++) {
+            float a = 1.0f - weights[i], b = weights[i];
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            ax += a * texels[i];
+            bx += b * texels[i];
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) return false;
+
+        first = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+        second = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+        return true;
+    }
+
+    float distanceSquared(const glm::vec4& a, const glm::vec4& b, int channels) {
+        glm::vec4 d = a - b;
+        if (channels < 4) d.w = 0.0f;
+        return glm::dot(d, d);
+    }
+
+    float assignIndices(const glm::vec4* texels, const glm::vec4* palette, int paletteSize, int channels, uint8_t* indices) {
+        float error = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            float best = INFINITY;
+            for (int p = 0; p < paletteSize; p++) {
+                float distance = distanceSquared(texels[i], palette[p], channels);
+                if (distance < best) {
+                    best = distance;
+                    indices[i] = (uint8_t) p;
+                }
+            }
+            error += best;
+        }
+        return error;
+    }
+
+    uint16_t to565(const glm::vec4& color) {
+        int r = (int) std::lround(color.r * 31.0f / 255.0f);
+        int g = (int) std::lround(color.g * 63.0f / 255.0f);
+        int b = (int) std::lround(color.b * 31.0f / 255.0f);
+        return (uint16_t) ((std::clamp(r, 0, 31) << 11) | (std::clamp(g, 0, 63) << 5) | std::clamp(b, 0, 31));
+    }
+
+    glm::vec4 from565(uint16_t color) {
+        int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+        return glm::vec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255.0f);
+    }
+
+    struct BC1Fit {
+        uint16_t color0, color1;
+        uint8_t indices[16];
+        float error;
+    };
+
+    void evaluateBC1(const glm::vec4* texels, const glm::vec4& first, const glm::vec4& second, BC1Fit& fit) {
+        fit.color0 = to565(first);
+        fit.color1 = to565(second);
+
+        glm::vec4 c0 = from565(fit.color0), c1 = from565(fit.color1);
+        glm::vec4 palette[4] = {c0, c1, (2.0f * c0 + c1) / 3.0f, (c0 + 2.0f * c1) / 3.0f};
+        fit.error = assignIndices(texels, palette, 4, 3, fit.indices);
+    }
+
+    // Quantized endpoint for BC7 mode 6: 7 bits per channel plus one shared low bit
+    struct BC7Endpoint {
+        uint8_t value[4];
+        uint8_t pBit;
+
+        glm::vec4 expanded() const {
+            return glm::vec4((value[0] << 1) | pBit, (value[1] << 1) | pBit, (value[2] << 1) | pBit, (value[3] << 1) | pBit);
+        }
+    };
+
+    BC7Endpoint quantizeBC7(const glm::vec4& color) {
+        BC7Endpoint best{};
+        float bestError = INFINITY;
+        for (uint8_t pBit = 0; pBit < 2; pBit++) {
+            BC7Endpoint endpoint{};
+            endpoint.pBit = pBit;
+            for (int c = 0; c < 4; c++) {
+                endpoint.value[c] = (uint8_t) std::clamp((int) std::lround((color[c] - pBit) * 0.5f), 0, 127);
+            }
+
+            float error = distanceSquared(endpoint.expanded(), color, 4);
+            if (error < bestError) {
+                bestError = error;
+                best = endpoint;
+            }
+        }
+        return best;
+    }
+
+    struct BC7Fit {
+        BC7Endpoint endpoints[2];
+        uint8_t indices[16];
+        float error;
+    };
+
+    void evaluateBC7(const glm::vec4* texels, const glm::vec4& first, const glm::vec4& second, BC7Fit& fit) {
+        fit.endpoints[0] = quantizeBC7(first);
+        fit.endpoints[1] = quantizeBC7(second);
+
+        glm::vec4 e0 = fit.endpoints[0].expanded(), e1 = fit.endpoints[1].expanded();
+        glm::vec4 palette[16];
+        for (int i = 0; i < 16; i++) {
+            palette[i] = glm::floor(((64.0f - BC7_WEIGHTS[i]) * e0 + (float) BC7_WEIGHTS[i] * e1 + 32.0f) / 64.0f);
+        }
+        fit.error = assignIndices(texels, palette, 16, 4, fit.indices);
+    }
+
+    void expandTexel(const uint8_t* source, int components, bool keepTwoChannels, uint8_t* rgba) {
+        switch (components) {
+            case 1:
+                rgba[0] = rgba[1] = rgba[2] = source[0];
+                rgba[3] = 255;
+                break;
+            case 2:
+                if (keepTwoChannels) {
+                    rgba[0] = source[0];
+                    rgba[1] = source[1];
+                    rgba[2] = 0;
+                    rgba[3] = 255;
+                }
+                else {
+                    rgba[0] = rgba[1] = rgba[2] = source[0];
+                    rgba[3] = source[1];
+                }
+                break;
+            case 3:
+                memcpy(rgba, source, 3);
+                rgba[3] = 255;
+                break;
+            default:
+                memcpy(rgba, source, 4);
+                break;
+        }
+    }
+
+    bool isMaskRole(const std::string& type) {
+        return type == "texture_metallic" || type == "texture_roughness" || type == "texture_ao" ||
+               type == "texture_specular" || type == "texture_height";
+    }
+}
+
+const char* assets::textureCompressionName(TextureCompression compression) {
+    switch (compression) {
+        case TextureCompression::BC1: return "BC1";
+        case TextureCompression::BC3: return "BC3";
+        case TextureCompression::BC4: return "BC4";
+        case TextureCompression::BC5: return "BC5";
+        case TextureCompression::BC7: return "BC7";
+        default: return "RGBA8";
+    }
+}
+
+bool assets::textureCompressionFromName(const std::string& name, TextureCompression& compression) {
+    const TextureCompression all[] = {TextureCompression::None, TextureCompression::BC1, TextureCompression::BC3,
+                                      TextureCompression::BC4, TextureCompression::BC5, TextureCompression::BC7};
+    for (TextureCompression candidate : all) {
+        if (name == textureCompressionName(candidate)) {
+            compression = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t assets::compressedBlockSize(TextureCompression compression) {
+    switch (compression) {
+        case TextureCompression::BC1:
+        case TextureCompression::BC4:
+            return 8;
+        case TextureCompression::BC3:
+        case TextureCompression::BC5:
+        case TextureCompression::BC7:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t assets::textureLevelSize(const Texture& texture, int level) {
+    if (texture.compression == TextureCompression::None) {
+        return mipLevelSize(texture.width, texture.height, texture.nrComponents, level);
+    }
+
+    size_t blocksX = (mipDimension(texture.width, level) + 3) / 4;
+    size_t blocksY = (mipDimension(texture.height, level) + 3) / 4;
+    return blocksX * blocksY * compressedBlockSize(texture.compression);
+}
+
+size_t assets::textureDataSize(const Texture& texture) {
+    size_t size = 0;
+    for (int level = 0; level < texture.mipLevels; level++) {
+        size += textureLevelSize(texture, level);
+    }
+    return size;
+}
+
+TextureCompression assets::chooseTextureCompression(const Texture& texture) {
+    int components = texture.nrComponents;
+    if (texture.data == nullptr || components < 1 || components > 4) {
+        return TextureCompression::None;
+    }
+
+    if (texture.type == "texture_normal" && components >= 2) {
+        return TextureCompression::BC5;
+    }
+    if (components == 1) {
+        return TextureCompression::BC4;
+    }
+
+    size_t texelCount = (size_t) texture.width * texture.height;
+    bool grey = components >= 3, opaque = true;
+    for (size_t i = 0; i < texelCount; i++) {
+        const unsigned char* texel = texture.data + i * components;
+        if (components >= 3 && (texel[0] != texel[1] || texel[0] != texel[2])) grey = false;
+        if ((components == 2 || components == 4) && texel[components - 1] != 255) opaque = false;
+    }
+
+    if (isMaskRole(texture.type) && grey && opaque) {
+        return TextureCompression::BC4;
+    }
+    if (!opaque) {
+        return texture.type == "texture_diffuse" ? TextureCompression::BC7 : TextureCompression::BC3;
+    }
+    return TextureCompression::BC1;
+}
+
+void assets::encodeBC1(const uint8_t* rgba, uint8_t* block) {
+    glm::vec4 texels[16];
+    loadTexels(rgba, texels);
+
+    glm::vec4 mean, low, high;
+    glm::vec4 axis = principalAxis(texels, 3, mean);
+    axisExtents(texels, mean, axis, low, high);
+
+    // Pulling the endpoints in a little lowers the error of the interpolated colors
+    glm::vec4 inset = (high - low) / 16.0f;
+    BC1Fit best;
+    evaluateBC1(texels, high - inset, low + inset, best);
+
+    const float weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    float texelWeights[16];
+    for (int i = 0; i < 16; i++) texelWeights[i] = weights[best.indices[i]];
+
+    glm::vec4 first, second;
+    if (leastSquaresEndpoints(texels, texelWeights, first, second)) {
+        BC1Fit refined;
+        evaluateBC1(texels, first, second, refined);
+        if (refined.error < best.error) best = refined;
+    }
+
+    // color0 > color1 selects the four color mode, swapping endpoints swaps 0 with 1 and 2 with 3
+    if (best.color0 < best.color1) {
+        std::swap(best.color0, best.color1);
+        for (uint8_t& index : best.indices) index ^= 1;
+    }
+    else if (best.color0 == best.color1) {
+        memset(best.indices, 0, sizeof(best.indices));
+    }
+
+    uint32_t packedIndices = 0;
+    for (int i = 0; i < 16; i++) packedIndices |= (uint32_t) best.indices[i] << (i * 2);
+
+    memcpy(block, &best.color0, 2);
+    memcpy(block + 2, &best.color1, 2);
+    memcpy(block + 4, &packedIndices, 4);
+}
+
+void assets::encodeBC4(const uint8_t* rgba, int channel, uint8_t* block) {
+    uint8_t low = 255, high = 0;
+    for (int i = 0; i < 16; i++) {
+        low = std::min(low, rgba[i * 4 + channel]);
+        high = std::max(high, rgba[i * 4 + channel]);
+    }
+
+    // high > low selects eight interpolated values, index 0 is high, 1 is low and 2-7 step from high to low
+    block[0] = high;
+    block[1] = low;
+    uint64_t packedIndices = 0;
+    if (high > low) {
+        for (int i = 0; i < 16; i++) {
+            int step = (int) std::lround((high - rgba[i * 4 + channel]) * 7.0f / (high - low));
+            uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+            packedIndices |= index << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++) {
+        block[2 + i] = (uint8_t) (packedIndices >> (i * 8));
+    }
+}
+
+void assets::encodeBC3(const uint8_t* rgba, uint8_t* block) {
+    encodeBC4(rgba, 3, block);
+    encodeBC1(rgba, block + 8);
+}
+
+void assets::encodeBC5(const uint8_t* rgba, uint8_t* block) {
+    encodeBC4(rgba, 0, block);
+    encodeBC4(rgba, 1, block + 8);
+}
+
+// Mode 6 only: one subset, RGBA endpoints and 4 bit indices, which suits smooth color with alpha
+void assets::encodeBC7(const uint8_t* rgba, uint8_t* block) {
+    glm::vec4 texels[16];
+    loadTexels(rgba, texels);
+
+    glm::vec4 mean, low, high;
+    glm::vec4 axis = principalAxis(texels, 4, mean);
+    axisExtents(texels, mean, axis, low, high);
+
+    BC7Fit best;
+    evaluateBC7(texels, low, high, best);
+
+    float texelWeights[16];
+    for (int i = 0; i < 16; i++) texelWeights[i] = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+
+    glm::vec4 first, second;
+    if (leastSquaresEndpoints(texels, texelWeights, first, second)) {
+        BC7Fit refined;
+        evaluateBC7(texels, first, second, refined);
+        if (refined.error < best.error) best = refined;
+    }
+
+    // The first index is stored without its top bit, so it has to be below 8
+    if (best.indices[0] >= 8) {
+        std::swap(best.endpoints[0], best.endpoints[1]);
+        for (uint8_t& index : best.indices) index = 15 - index;
+    }
+
+    memset(block, 0, 16);
+    BitWriter writer{block};
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(best.endpoints[0].value[c], 7);
+        writer.write(best.endpoints[1].value[c], 7);
+    }
+    writer.write(best.endpoints[0].pBit, 1);
+    writer.write(best.endpoints[1].pBit, 1);
+
+    writer.write(best.indices[0], 3);
+    for (int i = 1; i < 16; i++) writer.write(best.indices[i], 4);
+}
+
+bool assets::compressTexture(Texture& texture, TextureCompression compression) {
+    size_t blockSize = compressedBlockSize(compression);
+    if (texture.data == nullptr || texture.compression != TextureCompression::None || blockSize == 0) {
+        return false;
+    }
+
+    Texture compressed = texture;
+    compressed.compression = compression;
+    compressed.data = (unsigned char*) malloc(textureDataSize(compressed));
+    if (compressed.data == nullptr) {
+        return false;
+    }
+
+    int components = texture.nrComponents;
+    bool keepTwoChannels = compression == TextureCompression::BC5;
+    const unsigned char* source = texture.data;
+    unsigned char* destination = compressed.data;
+
+    for (int level = 0; level < texture.mipLevels; level++) {
+        int width = mipDimension(texture.width, level), height = mipDimension(texture.height, level);
+        size_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+
+        JobSystem::shared().parallelFor(blocksY, [&](size_t blockY) {
+            uint8_t rgba[64];
+            for (size_t blockX = 0; blockX < blocksX; blockX++) {
+                // Blocks hanging over the edge repeat the last row and column
+                for (int i = 0; i < 16; i++) {
+                    int x = std::min<int>(blockX * 4 + i % 4, width - 1);
+                    int y = std::min<int>(blockY * 4 + i / 4, height - 1);
+                    expandTexel(source + ((size_t) y * width + x) * components, components, keepTwoChannels, rgba + i * 4);
+                }
+
+                uint8_t* block = destination + (blockY * blocksX + blockX) * blockSize;
+                switch (compression) {
+                    case TextureCompression::BC1: encodeBC1(rgba, block); break;
+                    case TextureCompression::BC3: encodeBC3(rgba, block); break;
+                    case TextureCompression::BC4: encodeBC4(rgba, 0, block); break;
+                    case TextureCompression::BC5: encodeBC5(rgba, block); break;
+                    case TextureCompression::BC7: encodeBC7(rgba, block); break;
+                    default: break;
+                }
+            }
+        });
+
+        source += textureLevelSize(texture, level);
+        destination += textureLevelSize(compressed, level);
+    }
+
+    free(texture.data);
+    texture = compressed;
+    return true;
+}
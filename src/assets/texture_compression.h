@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "utils/types.h"
+
+namespace assets {
+
+const char* textureCompressionName(TextureCompression compression);
+bool textureCompressionFromName(const std::string& name, TextureCompression& compression);
+
+// Bytes per 4x4 block, 0 for uncompressed textures
+size_t compressedBlockSize(TextureCompression compression);
+// Bytes of one level of the texture as stored in Texture::data, compressed or not
+size_t textureLevelSize(const Texture& texture, int level);
+size_t textureDataSize(const Texture& texture);
+
+// BC5 for normal maps, BC4 for single channel or grey masks, BC7 for diffuse with alpha,
+// BC3 for other textures with alpha and BC1 for everything opaque
+TextureCompression chooseTextureCompression(const Texture& texture);
+
+// Encodes every mip level of an uncompressed texture and replaces texture.data with the blocks,
+// malloc'ed like stb_image data. Rows of blocks are spread over the shared job system.
+bool compressTexture(Texture& texture, TextureCompression compression);
+
+// Single block encoders, input is 16 RGBA texels in row order
+void encodeBC1(const uint8_t* rgba, uint8_t* block);
+void encodeBC3(const uint8_t* rgba, uint8_t* block);
+void encodeBC4(const uint8_t* rgba, int channel, uint8_t* block);
+void encodeBC5(const uint8_t* rgba, uint8_t* block);
+void encodeBC7(const uint8_t* rgba, uint8_t* block);
+}
@@ -0,0 +1,255 @@
+#include "texture_mips.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPS_USE_SSE 1
+#endif
+
+namespace {
+    constexpr float KAISER_WIDTH = 3.0f;
+    constexpr float KAISER_ALPHA = 4.0f;
+
+    struct Tap {
+        int index;
+        float weight;
+    };
+
+    // Source taps for every texel of the smaller level along one axis
+    using AxisTaps = std::vector<std::vector<Tap>>;
+
+    enum class Encoding {
+        Linear, SRGB, Normal
+    };
+
+    float besselI0(float x) {
+        float sum = 1.0f, term = 1.0f;
+        for (int k = 1; k < 20; k++) {
+            term *= (x * 0.5f / k) * (x * 0.5f / k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    float kaiserWeight(float x) {
+        float sinc = x == 0.0f ? 1.0f : std::sin(3.14159265f * x) / (3.14159265f * x);
+        float t = x / KAISER_WIDTH;
+        if (t * t >= 1.0f) return 0.0f;
+        return sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / besselI0(KAISER_ALPHA);
+    }
+
+    AxisTaps buildTaps(int sourceSize, assets::MipFilter filter) {
+        int size = std::max(1, sourceSize / 2);
+        AxisTaps taps(size);
+        if (sourceSize == 1) {
+            taps[0].push_back({0, 1.0f});
+            return taps;
+        }
+
+        for (int x = 0; x < size; x++) {
+            std::vector<Tap>& texel = taps[x];
+            if (filter == assets::MipFilter::Box) {
+                if (sourceSize % 2 == 0) {
+                    texel = {{2 * x, 0.5f}, {2 * x + 1, 0.5f}};
+                }
+                else {
+                    float n = (float) sourceSize;
+                    texel = {{2 * x, (size - x) / n}, {2 * x + 1, size / n}, {2 * x + 2, (x + 1) / n}};
+                }
+                continue;
+            }
+
+            // Distances are measured in texels of the smaller level, source indices wrap like GL_REPEAT
+            float scale = (float) sourceSize / size;
+            float center = (x + 0.5f) * scale;
+            int radius = (int) std::ceil(KAISER_WIDTH * scale);
+            float total = 0.0f;
+            for (int i = (int) center - radius; i <= (int) center + radius; i++) {
+                float weight = kaiserWeight((i + 0.5f - center) / scale);
+                if (weight == 0.0f) continue;
+
+                int index = ((i % sourceSize) + sourceSize) % sourceSize;
+                texel.push_back({index, weight});
+                total += weight;
+            }
+            for (Tap& tap : texel) tap.weight /= total;
+        }
+        return taps;
+    }
+
+    // destination += weight * source, all four channels at once
+    inline void accumulate(glm::vec4& destination, const glm::vec4& source, float weight) {
+#ifdef MIPS_USE_SSE
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(&destination.x), _mm_mul_ps(_mm_set1_ps(weight), _mm_loadu_ps(&source.x)));
+        _mm_storeu_ps(&destination.x, sum);
+#else
+        destination += weight * source;
+#endif
+    }
+
+    void accumulateRow(glm::vec4* destination, const glm::vec4* source, float weight, int count) {
+#ifdef MIPS_USE_SSE
+        __m128 w = _mm_set1_ps(weight);
+        for (int i = 0; i < count; i++) {
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(&destination[i].x), _mm_mul_ps(w, _mm_loadu_ps(&source[i].x)));
+            _mm_storeu_ps(&destination[i].x, sum);
+        }
+#else
+        for (int i = 0; i < count; i++) destination[i] += weight * source[i];
+#endif
+    }
+
+    // Separable downsample: rows first into `scratch`, then columns one whole row at a time
+    void downsample(const std::vector<glm::vec4>& source, int width, int height, const AxisTaps& horizontal,
+                    const AxisTaps& vertical, std::vector<glm::vec4>& scratch, std::vector<glm::vec4>& destination) {
+        int newWidth = (int) horizontal.size(), newHeight = (int) vertical.size();
+
+        scratch.assign((size_t) newWidth * height, glm::vec4(0.0f));
+        for (int y = 0; y < height; y++) {
+            const glm::vec4* row = &source[(size_t) y * width];
+            glm::vec4* output = &scratch[(size_t) y * newWidth];
+            for (int x = 0; x < newWidth; x++) {
+                for (const Tap& tap : horizontal[x]) accumulate(output[x], row[tap.index], tap.weight);
+            }
+        }
+
+        destination.assign((size_t) newWidth * newHeight, glm::vec4(0.0f));
+        for (int y = 0; y < newHeight; y++) {
+            glm::vec4* output = &destination[(size_t) y * newWidth];
+            for (const Tap& tap : vertical[y]) {
+                accumulateRow(output, &scratch[(size_t) tap.index * newWidth], tap.weight, newWidth);
+            }
+        }
+    }
+
+    float srgbToLinear(float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float value) {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    void decodeLevel(const unsigned char* texels, size_t count, int components, Encoding encoding,
+                     std::vector<glm::vec4>& output) {
+        int colorComponents = components >= 3 ? 3 : 1;
+        float decode[256];
+        for (int i = 0; i < 256; i++) {
+            float value = i / 255.0f;
+            decode[i] = encoding == Encoding::SRGB ? srgbToLinear(value) :
+                        encoding == Encoding::Normal ? value * 2.0f - 1.0f : value;
+        }
+
+        output.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            glm::vec4 texel(0.0f, 0.0f, 0.0f, 1.0f);
+            for (int c = 0; c < components; c++) {
+                unsigned char value = texels[i * components + c];
+                texel[c] = c < colorComponents ? decode[value] : value / 255.0f;
+            }
+            output[i] = texel;
+        }
+    }
+
+    void encodeLevel(const std::vector<glm::vec4>& texels, int components, Encoding encoding, unsigned char* output) {
+        int colorComponents = components >= 3 ? 3 : 1;
+        for (size_t i = 0; i < texels.size(); i++) {
+            glm::vec4 texel = texels[i];
+            if (encoding == Encoding::Normal && components >= 3) {
+                glm::vec3 normal(texel);
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                texel = glm::vec4(normal * 0.5f + 0.5f, texel.w);
+            }
+
+            for (int c = 0; c < components; c++) {
+                float value = texel[c];
+                if (c < colorComponents && encoding == Encoding::SRGB) value = linearToSrgb(std::max(value, 0.0f));
+                else if (c < colorComponents && encoding == Encoding::Normal && components < 3) value = value * 0.5f + 0.5f;
+                output[i * components + c] = (unsigned char) (std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+const char* assets::mipFilterName(MipFilter filter) {
+    return filter == MipFilter::Kaiser ? "kaiser" : "box";
+}
+
+bool assets::mipFilterFromName(const std::string& name, MipFilter& filter) {
+    if (name == "box") filter = MipFilter::Box;
+    else if (name == "kaiser") filter = MipFilter::Kaiser;
+    else return false;
+    return true;
+}
+
+int assets::mipLevelCount(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+int assets::mipDimension(int size, int level) {
+    return std::max(1, size >> level);
+}
+
+size_t assets::mipLevelSize(int width, int height, int components, int level) {
+    return (size_t) mipDimension(width, level) * mipDimension(height, level) * components;
+}
+
+size_t assets::mipChainSize(int width, int height, int components, int levels) {
+    size_t size = 0;
+    for (int level = 0; level < levels; level++) {
+        size += mipLevelSize(width, height, components, level);
+    }
+    return size;
+}
+
+bool assets::generateMips(Texture& texture, MipFilter filter) {
+    if (texture.data == nullptr || texture.nrComponents < 1 || texture.nrComponents > 4) {
+        return false;
+    }
+
+    int levels = mipLevelCount(texture.width, texture.height);
+    unsigned char* chain = (unsigned char*) malloc(mipChainSize(texture.width, texture.height, texture.nrComponents, levels));
+    if (chain == nullptr) {
+        return false;
+    }
+
+    // Albedo is stored gamma encoded, averaging the encoded values darkens every level
+    Encoding encoding = texture.type == "texture_diffuse" ? Encoding::SRGB :
+                        texture.type == "texture_normal" ? Encoding::Normal : Encoding::Linear;
+
+    size_t baseSize = mipLevelSize(texture.width, texture.height, texture.nrComponents, 0);
+    memcpy(chain, texture.data, baseSize);
+
+    std::vector<glm::vec4> current, next, scratch;
+    decodeLevel(texture.data, (size_t) texture.width * texture.height, texture.nrComponents, encoding, current);
+
+    // Each level is filtered from the float copy of the previous one, so rounding never accumulates
+    unsigned char* output = chain + baseSize;
+    int width = texture.width, height = texture.height;
+    for (int level = 1; level < levels; level++) {
+        downsample(current, width, height, buildTaps(width, filter), buildTaps(height, filter), scratch, next);
+        width = mipDimension(texture.width, level);
+        height = mipDimension(texture.height, level);
+
+        encodeLevel(next, texture.nrComponents, encoding, output);
+        output += mipLevelSize(texture.width, texture.height, texture.nrComponents, level);
+        std::swap(current, next);
+    }
+
+    free(texture.data);
+    texture.data = chain;
+    texture.mipLevels = levels;
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+#include "utils/types.h"
+
+namespace assets {
+
+enum class MipFilter : uint32_t {
+    // 2x2 average, 3 taps along odd dimensions
+    Box = 0,
+    // Kaiser windowed sinc over 3 texels of the smaller level each way, sharper than box
+    Kaiser = 1
+};
+
+const char* mipFilterName(MipFilter filter);
+bool mipFilterFromName(const std::string& name, MipFilter& filter);
+
+// Down to 1x1
+int mipLevelCount(int width, int height);
+int mipDimension(int size, int level);
+// Bytes of 8 bit texels, levels are stored back to back without row padding
+size_t mipLevelSize(int width, int height, int components, int level);
+size_t mipChainSize(int width, int height, int components, int levels);
+
+// Replaces texture.data with the full chain in a malloc'ed buffer, so it is freed like stb_image data.
+// Diffuse textures are filtered in linear space and normal maps are renormalized.
+bool generateMips(Texture& texture, MipFilter filter);
+}
@@ -0,0 +1,65 @@
+#include "texture_registry.h"
+
+#include "asset_cache.h"
+
+namespace assets {
+
+TextureRegistry& TextureRegistry::shared() {
+    static TextureRegistry registry;
+    return registry;
+}
+
+TextureHandle TextureRegistry::find(uint64_t key) {
+    if (key == 0) return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iterator = textures.find(key);
+    if (iterator == textures.end()) return nullptr;
+
+    TextureHandle handle = iterator->second.lock();
+    if (handle) reuses++;
+    return handle;
+}
+
+TextureHandle TextureRegistry::add(uint64_t key, const Texture& texture) {
+    auto* entry = new SharedTexture{key, texture};
+    entry->texture.data = nullptr;
+
+    // Runs on whichever thread drops the last handle, only the id is handed over
+    TextureHandle handle(entry, [this](const SharedTexture* entry) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            unused.push_back(entry->texture.id);
+
+            auto iterator = textures.find(entry->key);
+            if (iterator != textures.end() && iterator->second.expired()) {
+                textures.erase(iterator);
+            }
+        }
+        delete entry;
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    textures[key] = handle;
+    return handle;
+}
+
+std::vector<unsigned int> TextureRegistry::collectUnused() {
+    std::vector<unsigned int> collected;
+    std::lock_guard<std::mutex> lock(mutex);
+    collected.swap(unused);
+    return collected;
+}
+
+size_t TextureRegistry::textureCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return textures.size();
+}
+
+uint64_t textureContentKey(uint64_t sourceHash, const std::string& type, uint64_t bakeSettings) {
+    if (sourceHash == 0) return 0;
+
+    uint64_t key = hashBytes(&sourceHash, sizeof(sourceHash), hashString(type));
+    return hashBytes(&bakeSettings, sizeof(bakeSettings), key);
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/types.h"
+
+namespace assets {
+
+// A texture already on the GPU. texture.data is always null, its pixels only ever lived in the upload.
+struct SharedTexture {
+    uint64_t key = 0;
+    Texture texture;
+};
+
+// Keeps a registered texture alive, the registry gives up its id once the last handle is gone
+using TextureHandle = std::shared_ptr<const SharedTexture>;
+
+// Textures of every loaded model keyed by their content, so an image several models use is decoded
+// and uploaded once. Lookups and handles work from any thread, the registry itself never touches GL:
+// ids nobody holds a handle to any more are collected on the main thread and deleted there.
+class TextureRegistry {
+public:
+    static TextureRegistry& shared();
+
+    // Null when nothing with this key is registered, key 0 never is
+    TextureHandle find(uint64_t key);
+    // Main thread, once texture is uploaded and find came up empty. Only the main thread adds, so
+    // nothing can register the same key in between.
+    TextureHandle add(uint64_t key, const Texture& texture);
+    // Main thread. Ids whose last handle went away since the previous call.
+    std::vector<unsigned int> collectUnused();
+
+    size_t textureCount() const;
+    // Loads that found their texture already registered
+    size_t reuseCount() const { return reuses; }
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, std::weak_ptr<const SharedTexture>> textures;
+    std::vector<unsigned int> unused;
+    std::atomic<size_t> reuses = 0;
+};
+
+// Key of what ends up on the GPU for an image: the source bytes, the role it is used in, which can
+// pick a different compression, and the bake settings when it comes out of a pack.
+uint64_t textureContentKey(uint64_t sourceHash, const std::string& type, uint64_t bakeSettings = 0);
+}
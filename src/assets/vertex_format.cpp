@@ -0,0 +1,151 @@
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+    // Half floats keep about 11 bits of mantissa. Past this range UVs lose sub-texel precision
+    // on large textures, so widely tiled meshes stay in Float32.
+    constexpr float MAX_HALF_TEXCOORD = 4.0f;
+
+    glm::vec2 signNotZero(glm::vec2 value) {
+        return {value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f};
+    }
+
+    glm::vec2 octahedralEncode(glm::vec3 direction) {
+        float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+        if (length == 0.0f) return glm::vec2(0.0f);
+
+        direction /= length;
+        glm::vec2 encoded(direction.x, direction.y);
+        if (direction.z < 0.0f) {
+            encoded = (1.0f - glm::abs(glm::vec2(direction.y, direction.x))) * signNotZero(encoded);
+        }
+
+        return encoded;
+    }
+
+    glm::vec3 octahedralDecode(glm::vec2 encoded) {
+        glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+        float fold = std::max(-direction.z, 0.0f);
+        direction.x += direction.x >= 0.0f ? -fold : fold;
+        direction.y += direction.y >= 0.0f ? -fold : fold;
+
+        return glm::normalize(direction);
+    }
+
+    void packDirection(glm::vec3 direction, int16_t* packed) {
+        glm::vec2 encoded = octahedralEncode(direction);
+        packed[0] = (int16_t) glm::packSnorm1x16(encoded.x);
+        packed[1] = (int16_t) glm::packSnorm1x16(encoded.y);
+    }
+
+    glm::vec3 unpackDirection(const int16_t* packed) {
+        return octahedralDecode(glm::vec2(glm::unpackSnorm1x16((uint16_t) packed[0]),
+                                          glm::unpackSnorm1x16((uint16_t) packed[1])));
+    }
+}
+
+const char* assets::vertexFormatName(VertexFormat format) {
+    switch (format) {
+        case VertexFormat::Quantized16: return "PNT_Q16_OCT";
+        default: return "PNTTB_F32";
+    }
+}
+
+bool assets::vertexFormatFromName(const std::string& name, VertexFormat& format) {
+    if (name == "PNTTB_F32") {
+        format = VertexFormat::Float32;
+        return true;
+    }
+    if (name == "PNT_Q16_OCT") {
+        format = VertexFormat::Quantized16;
+        return true;
+    }
+
+    return false;
+}
+
+size_t assets::vertexFormatStride(VertexFormat format) {
+    return format == VertexFormat::Quantized16 ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+size_t assets::indexTypeSize(IndexType type) {
+    return type == IndexType::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+assets::IndexType assets::chooseIndexType(size_t vertexCount) {
+    return vertexCount <= MAX_UINT16_INDEXED_VERTICES ? IndexType::UInt16 : IndexType::UInt32;
+}
+
+assets::VertexFormat assets::chooseVertexFormat(const Vertex* vertices, size_t vertexCount) {
+    for (size_t i = 0; i < vertexCount; i++) {
+        const glm::vec2& texCoords = vertices[i].TexCoords;
+        if (!(std::abs(texCoords.x) <= MAX_HALF_TEXCOORD && std::abs(texCoords.y) <= MAX_HALF_TEXCOORD)) {
+            return VertexFormat::Float32;
+        }
+    }
+
+    return VertexFormat::Quantized16;
+}
+
+glm::vec3 assets::quantizationScale(const BoundingBox& aabb) {
+    return glm::vec3(aabb.maxPoint) - glm::vec3(aabb.minPoint);
+}
+
+glm::vec3 assets::quantizationOffset(const BoundingBox& aabb) {
+    return glm::vec3(aabb.minPoint);
+}
+
+void assets::packVertices(const Vertex* vertices, size_t vertexCount, const BoundingBox& aabb, PackedVertex* packed) {
+    glm::vec3 offset = quantizationOffset(aabb);
+    glm::vec3 scale = quantizationScale(aabb);
+    glm::vec3 inverseScale(scale.x > 0.0f ? 1.0f / scale.x : 0.0f,
+                           scale.y > 0.0f ? 1.0f / scale.y : 0.0f,
+                           scale.z > 0.0f ? 1.0f / scale.z : 0.0f);
+
+    for (size_t i = 0; i < vertexCount; i++) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& result = packed[i];
+
+        glm::vec3 normalized = glm::clamp((vertex.Position - offset) * inverseScale, 0.0f, 1.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            result.position[axis] = glm::packUnorm1x16(normalized[axis]);
+        }
+
+        packDirection(vertex.Normal, result.normal);
+        packDirection(vertex.Tangent, result.tangent);
+
+        float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent);
+        result.bitangentSign = handedness < 0.0f ? 0 : 0xFFFF;
+
+        uint32_t texCoords = glm::packHalf2x16(vertex.TexCoords);
+        result.texCoords[0] = texCoords & 0xFFFF;
+        result.texCoords[1] = texCoords >> 16;
+    }
+}
+
+void assets::unpackVertices(const PackedVertex* packed, size_t vertexCount, const BoundingBox& aabb, Vertex* vertices) {
+    glm::vec3 offset = quantizationOffset(aabb);
+    glm::vec3 scale = quantizationScale(aabb);
+
+    for (size_t i = 0; i < vertexCount; i++) {
+        const PackedVertex& source = packed[i];
+        Vertex& vertex = vertices[i];
+
+        glm::vec3 normalized(glm::unpackUnorm1x16(source.position[0]),
+                             glm::unpackUnorm1x16(source.position[1]),
+                             glm::unpackUnorm1x16(source.position[2]));
+        vertex.Position = normalized * scale + offset;
+
+        vertex.Normal = unpackDirection(source.normal);
+        vertex.Tangent = unpackDirection(source.tangent);
+
+        float handedness = source.bitangentSign == 0 ? -1.0f : 1.0f;
+        vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * handedness;
+
+        vertex.TexCoords = glm::unpackHalf2x16(source.texCoords[0] | ((uint32_t) source.texCoords[1] << 16));
+        vertex.ID = i;
+    }
+}
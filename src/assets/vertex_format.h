@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "utils/types.h"
+
+namespace assets {
+
+enum class VertexFormat : uint32_t {
+    // The Vertex struct as is, 60 bytes
+    Float32 = 0,
+    // PackedVertex, 20 bytes
+    Quantized16 = 1
+};
+
+// Positions are unorm16 inside the mesh AABB, normal and tangent are snorm16 octahedral
+// encodings and the bitangent is rebuilt as cross(normal, tangent) * sign. The sign sits in
+// the otherwise unused w of the position so it is fetched with it.
+// Vertex.ID is not stored, it always matches gl_VertexID.
+struct PackedVertex {
+    uint16_t position[3];
+    uint16_t bitangentSign;
+    int16_t normal[2];
+    int16_t tangent[2];
+    // Half floats
+    uint16_t texCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex is uploaded to the GPU as is");
+
+enum class IndexType : uint32_t {
+    UInt32 = 0,
+    UInt16 = 1
+};
+
+// Largest vertex count 16 bit indices can address
+constexpr size_t MAX_UINT16_INDEXED_VERTICES = 65536;
+
+const char* vertexFormatName(VertexFormat format);
+bool vertexFormatFromName(const std::string& name, VertexFormat& format);
+size_t vertexFormatStride(VertexFormat format);
+
+size_t indexTypeSize(IndexType type);
+IndexType chooseIndexType(size_t vertexCount);
+
+// Picks the smallest format that keeps the mesh's attributes within tolerance
+VertexFormat chooseVertexFormat(const Vertex* vertices, size_t vertexCount);
+
+void packVertices(const Vertex* vertices, size_t vertexCount, const BoundingBox& aabb, PackedVertex* packed);
+void unpackVertices(const PackedVertex* packed, size_t vertexCount, const BoundingBox& aabb, Vertex* vertices);
+
+// Shaders rebuild positions as unorm * scale + offset
+glm::vec3 quantizationScale(const BoundingBox& aabb);
+glm::vec3 quantizationOffset(const BoundingBox& aabb);
+}
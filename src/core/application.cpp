@@ -126,12 +126,10 @@ void Application::init()
     mRenderer.init_resources();
     mRenderer.subscribePrograms(updateListener);
 
-    Model newModel("sponzaBasic/glTF/Sponza.gltf", GLTF);
     auto model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(0.1f));
-    newModel.model_matrix = model;
-    mRenderer.loadModelData(newModel);
-    usableObjs.push_back(newModel);
+    // Picking only tests bounds, so nothing needs the scene's vertices after upload
+    asyncLoadModel("sponzaBasic/glTF/Sponza.gltf", GLTF, model, GeometryResidency::Release);
 
     mRenderer.handleObjs(usableObjs);
 
@@ -238,20 +236,15 @@ void Application::handleEvents()
 
 void Application::handleImportedObjs()
 {
-    if (!importedObjs.empty()) {
-        Model model = importedObjs[importedObjs.size() - 1];
-        mRenderer.loadModelData(model);
-
-        importedObjs.pop_back();
-        usableObjs.push_back(model);
+    if (modelLoader.update(mRenderer, usableObjs, importBudgetMs)) {
+        mRenderer.handleObjs(usableObjs);
     }
 }
 
-void Application::asyncLoadModel(std::string path, FileType type)
+std::shared_ptr<ModelLoadHandle> Application::asyncLoadModel(std::string path, FileType type, const glm::mat4& modelMatrix,
+                                                             GeometryResidency residency)
 {
-    Model newModel(std::move(path), type);
-
-    importedObjs.push_back(newModel);
+    return modelLoader.load(std::move(path), type, modelMatrix, residency);
 }
 
 void Application::handleMouse(double xposIn, double yposIn)
@@ -309,9 +302,9 @@ void Application::handleClick(double xposIn, double yposIn)
 
 void Application::checkIntersection(glm::vec4& origin, glm::vec4& direction, glm::vec4& inverse_dir)
 {
-    for (int i = 0; i < usableObjs.size(); i++) {
-        glm::vec4 boxMin = usableObjs[i].model_matrix * usableObjs[i].aabb.minPoint;
-        glm::vec4 boxMax = usableObjs[i].model_matrix * usableObjs[i].aabb.maxPoint;
+    for (size_t i = 0; i < usableObjs.size(); i++) {
+        glm::vec4 boxMin = usableObjs[i].model_matrix * usableObjs[i].resource->aabb.minPoint;
+        glm::vec4 boxMax = usableObjs[i].model_matrix * usableObjs[i].resource->aabb.maxPoint;
 
         float tmin = -INFINITY, tmax = INFINITY;
         if (direction.x != 0.0f) {
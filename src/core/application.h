@@ -4,6 +4,7 @@
 #include <SDL.h>
 
 #include <renderer/gl_renderer.h>
+#include "core/model_loader.h"
 
 class Application {
 public:
@@ -23,7 +24,9 @@ private:
     void handleClick(double xposIn, double yposIn);
     void checkIntersection(glm::vec4& origin, glm::vec4& direction, glm::vec4& inverse_dir);
 
-    void asyncLoadModel(std::string path, FileType type = OBJ);
+    std::shared_ptr<ModelLoadHandle> asyncLoadModel(std::string path, FileType type = OBJ,
+                                                    const glm::mat4& modelMatrix = glm::mat4(1.0f),
+                                                    GeometryResidency residency = GeometryResidency::Keep);
 
 	GLRenderer mRenderer;
     SceneEditor mEditor;
@@ -41,8 +44,10 @@ private:
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
 
-    std::vector<Model> importedObjs;
-    std::vector<Model> usableObjs;
+    // Milliseconds of GL uploads per frame for models still loading
+    double importBudgetMs = 4.0;
+    ModelLoader modelLoader;
+    std::vector<ModelInstance> usableObjs;
     int chosenObjIndex = 0;
 
     efsw::FileWatcher fileWatcher;
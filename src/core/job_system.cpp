@@ -0,0 +1,264 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+namespace {
+    // Which system and queue the current thread works for, workers are never shared between systems
+    thread_local JobSystem* currentSystem = nullptr;
+    thread_local unsigned int currentQueue = 0;
+
+    std::mutex sharedMutex;
+    bool sharedCreated = false;
+    unsigned int sharedWorkerCount = JobSystem::defaultWorkerCount();
+}
+
+JobSystem::JobSystem(unsigned int numWorkers) : workerCount(numWorkers) {
+    for (unsigned int i = 0; i <= workerCount; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+JobSystem& JobSystem::shared() {
+    static JobSystem system([]() {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedCreated = true;
+        return sharedWorkerCount;
+    }());
+    return system;
+}
+
+bool JobSystem::setSharedWorkerCount(unsigned int numWorkers) {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (sharedCreated) return false;
+
+    sharedWorkerCount = numWorkers;
+    return true;
+}
+
+unsigned int JobSystem::defaultWorkerCount() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+JobSystem::JobHandle JobSystem::schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies) {
+    return schedule(std::move(work), dependencies, false);
+}
+
+JobSystem::JobHandle JobSystem::scheduleBackground(std::function<void()> work, const std::vector<JobHandle>& dependencies) {
+    return schedule(std::move(work), dependencies, true);
+}
+
+JobSystem::JobHandle JobSystem::schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies,
+                                         bool background) {
+    auto job = std::make_shared<Job>();
+    job->work = std::move(work);
+    job->background = background;
+    job->unmetDependencies = dependencies.size() + 1;
+
+    for (const JobHandle& dependency : dependencies) {
+        if (dependency == nullptr) {
+            job->unmetDependencies--;
+            continue;
+        }
+
+        // done is only set under the dependency's lock, so it either sees this job or is already over
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->done) {
+            job->unmetDependencies--;
+        }
+        else {
+            dependency->dependents.push_back(job);
+        }
+    }
+
+    if (job->unmetDependencies.fetch_sub(1) == 1) {
+        enqueue(job);
+    }
+    return job;
+}
+
+void JobSystem::enqueue(JobHandle job) {
+    bool background = job->background;
+    WorkQueue& queue = background ? backgroundQueue : currentSystem == this ? *queues[currentQueue] : *queues.back();
+    // Counted before it is visible, a thief taking it right away would otherwise decrement first and wrap the count
+    (background ? queuedBackgroundJobs : queuedJobs)++;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    // A waiting thread could swallow a single wakeup it can't use for a background job
+    if (background) {
+        wakeCondition.notify_all();
+    }
+    else {
+        wakeCondition.notify_one();
+    }
+}
+
+JobSystem::JobHandle JobSystem::takeJob(bool takeBackground) {
+    JobHandle job;
+    auto popBack = [&](WorkQueue& queue) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        return true;
+    };
+    auto popFront = [&](WorkQueue& queue) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        return true;
+    };
+
+    // Newest own job first, then jobs handed in from outside, then the oldest job of another worker
+    // and background jobs last
+    bool isWorker = currentSystem == this && currentQueue < workerCount;
+    bool found = (isWorker && popBack(*queues[currentQueue])) || popFront(*queues.back());
+
+    size_t start = isWorker ? currentQueue + 1 : 0;
+    for (size_t i = 0; !found && i < workerCount; i++) {
+        size_t victim = (start + i) % workerCount;
+        if (isWorker && victim == currentQueue) continue;
+        found = popFront(*queues[victim]);
+    }
+
+    if (found) {
+        queuedJobs--;
+    }
+    else if (takeBackground && popFront(backgroundQueue)) {
+        queuedBackgroundJobs--;
+    }
+    return job;
+}
+
+bool JobSystem::tryRunJob(bool takeBackground) {
+    JobHandle job = takeJob(takeBackground);
+    if (job == nullptr) {
+        return false;
+    }
+
+    job->work();
+    // Release whatever the job captured before anyone waiting on it wakes up
+    job->work = nullptr;
+    finish(*job);
+    return true;
+}
+
+void JobSystem::finish(Job& job) {
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.done = true;
+        dependents.swap(job.dependents);
+    }
+
+    for (JobHandle& dependent : dependents) {
+        if (dependent->unmetDependencies.fetch_sub(1) == 1) {
+            enqueue(std::move(dependent));
+        }
+    }
+
+    if (waitingThreads > 0) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+        }
+        wakeCondition.notify_all();
+    }
+}
+
+bool JobSystem::isDone(const JobHandle& job) {
+    return job == nullptr || job->done;
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    while (!isDone(job)) {
+        // Without workers nobody else would ever run background jobs
+        if (tryRunJob(workerCount == 0)) continue;
+
+        // Nothing to help with, the job is running on another thread or waits on one that is
+        waitingThreads++;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait(lock, [&]() { return isDone(job) || queuedJobs > 0; });
+        }
+        waitingThreads--;
+    }
+}
+
+void JobSystem::wait(const std::vector<JobHandle>& jobs) {
+    for (const JobHandle& job : jobs) {
+        wait(job);
+    }
+}
+
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& body, size_t grainSize) {
+    if (count == 0) return;
+
+    size_t threads = workerCount + 1;
+    if (grainSize == 0) {
+        grainSize = std::max<size_t>(1, count / (threads * 4));
+    }
+    size_t chunkCount = (count + grainSize - 1) / grainSize;
+    if (chunkCount == 1) {
+        for (size_t i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    // Chunks are claimed from a shared counter, helpers that start late find nothing left and return
+    std::atomic<size_t> nextChunk = 0;
+    auto runChunks = [&]() {
+        size_t chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < chunkCount) {
+            size_t end = std::min(count, (chunk + 1) * grainSize);
+            for (size_t i = chunk * grainSize; i < end; i++) body(i);
+        }
+    };
+
+    std::vector<JobHandle> helpers;
+    size_t helperCount = std::min(chunkCount - 1, threads - 1);
+    helpers.reserve(helperCount);
+    for (size_t i = 0; i < helperCount; i++) {
+        helpers.push_back(schedule(runChunks));
+    }
+
+    runChunks();
+    wait(helpers);
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+    currentSystem = this;
+    currentQueue = index;
+
+    while (true) {
+        if (tryRunJob(true)) continue;
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCondition.wait(lock, [this]() { return stopping || queuedJobs > 0 || queuedBackgroundJobs > 0; });
+
+        // Queued work is still finished before the system shuts down
+        if (stopping && queuedJobs == 0 && queuedBackgroundJobs == 0) return;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing scheduler shared by the engine. Every worker owns a deque: it pushes and pops
+// its own jobs at the back and idle workers steal from the front of the others, so jobs spawned
+// by a job stay on the thread that made them while their data is still in cache. Threads that
+// aren't workers, like the main thread, hand jobs in through a shared queue.
+//
+// Jobs can depend on other jobs and only become runnable once those have finished. Waiting never
+// just blocks: a thread waiting on a job runs other jobs until it is done, which is what makes
+// nested parallelFor and waiting from inside a job safe.
+class JobSystem {
+public:
+    struct Job;
+    using JobHandle = std::shared_ptr<Job>;
+
+    // The thread that waits helps out, so by default one core is left to it. With no workers every
+    // job runs on whichever thread waits for it.
+    explicit JobSystem(unsigned int numWorkers = defaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Runs work once every job in dependencies has finished. Null dependencies are ignored.
+    JobHandle schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies = {});
+    // For long jobs like a whole model import. Only idle workers pick these up, never a thread that
+    // is helping while it waits, so a frame or a parallelFor can't get stuck behind one.
+    JobHandle scheduleBackground(std::function<void()> work, const std::vector<JobHandle>& dependencies = {});
+
+    template<typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<F>>;
+
+    // Runs other jobs on the calling thread until job has finished
+    void wait(const JobHandle& job);
+    void wait(const std::vector<JobHandle>& jobs);
+    static bool isDone(const JobHandle& job);
+
+    // Runs body(0..count-1) and returns once every index is done. Indices are handed out in chunks
+    // of grainSize, 0 picks a size that gives each thread a few chunks to balance with.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body, size_t grainSize = 0);
+
+    unsigned int size() const { return workerCount; }
+
+    // Process wide scheduler sized to the machine, or to setSharedWorkerCount
+    static JobSystem& shared();
+    // Only takes effect before the first call to shared(), returns false after it
+    static bool setSharedWorkerCount(unsigned int numWorkers);
+    static unsigned int defaultWorkerCount();
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    JobHandle schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies, bool background);
+    void enqueue(JobHandle job);
+    void finish(Job& job);
+    bool tryRunJob(bool takeBackground);
+    JobHandle takeJob(bool takeBackground);
+    void workerLoop(unsigned int index);
+
+    // Fixed before any worker starts, workers read it while the rest are still being created
+    unsigned int workerCount;
+    std::vector<std::thread> workers;
+    // One per worker, the last one is shared by threads outside the system
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    WorkQueue backgroundQueue;
+
+    std::atomic<size_t> queuedJobs = 0;
+    std::atomic<size_t> queuedBackgroundJobs = 0;
+    std::atomic<unsigned int> waitingThreads = 0;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool stopping = false;
+};
+
+struct JobSystem::Job {
+    std::function<void()> work;
+    bool background = false;
+
+    // Unfinished dependencies, plus one held by schedule until every dependency is linked
+    std::atomic<size_t> unmetDependencies = 1;
+    std::atomic<bool> done = false;
+
+    std::mutex mutex;
+    std::vector<JobHandle> dependents;
+};
+
+template<typename F>
+auto JobSystem::submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+    using ResultType = std::invoke_result_t<F>;
+
+    // std::function needs a copyable callable, packaged_task is move only
+    auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+    std::future<ResultType> result = packagedTask->get_future();
+
+    schedule([packagedTask]() { (*packagedTask)(); });
+    return result;
+}
@@ -0,0 +1,215 @@
+#include "model_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "stb_image.h"
+
+bool ModelLoadHandle::finished() const {
+    ModelLoadState state = currentState;
+    return state == ModelLoadState::Done || state == ModelLoadState::Cancelled || state == ModelLoadState::Failed;
+}
+
+namespace {
+    void freeDecodedPixels(ModelResource& model, const BaseRenderer::ModelUpload& upload) {
+        // GL objects of half uploaded models go away with the context, only CPU side pixels are left
+        for (unsigned char* data : upload.pendingFrees) {
+            stbi_image_free(data);
+        }
+        for (size_t i = upload.nextTexture; i < upload.textures.size(); i++) {
+            stbi_image_free(upload.textures[i]->data);
+        }
+        if (!upload.started) {
+            for (auto& [path, texture] : model.textures_loaded) stbi_image_free(texture.data);
+        }
+    }
+}
+
+ModelLoader::~ModelLoader() {
+    JobSystem::shared().wait(jobs);
+
+    for (const std::shared_ptr<Import>& import : completed) {
+        if (import->model) freeDecodedPixels(*import->model, import->upload);
+    }
+}
+
+std::shared_ptr<ModelLoadHandle> ModelLoader::load(std::string path, FileType type, const glm::mat4& modelMatrix,
+                                                   GeometryResidency residency) {
+    auto handle = std::make_shared<ModelLoadHandle>(path);
+    pending++;
+
+    if (std::shared_ptr<ModelResource> resource = resources[path].lock()) {
+        resident.push_back({{handle, modelMatrix}, std::move(resource)});
+        return handle;
+    }
+
+    // An abandoned import may already have skipped its work, so it isn't joined
+    std::shared_ptr<Import>& import = imports[path];
+    if (import && !import->abandoned) {
+        import->placements.push_back({handle, modelMatrix});
+        import->residency = std::min(import->residency, residency);
+        return handle;
+    }
+
+    import = std::make_shared<Import>();
+    import->path = std::move(path);
+    import->type = type;
+    import->residency = residency;
+    import->placements.push_back({handle, modelMatrix});
+
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), JobSystem::isDone), jobs.end());
+    jobs.push_back(JobSystem::shared().scheduleBackground([this, import]() {
+        this->import(import);
+    }));
+    return handle;
+}
+
+void ModelLoader::import(const std::shared_ptr<Import>& import) {
+    if (import->abandoned) {
+        import->state = ModelLoadState::Cancelled;
+    }
+    else {
+        import->state = ModelLoadState::Importing;
+        auto model = std::make_shared<ModelResource>(import->path, import->type);
+        import->progress = 0.5f;
+
+        if (model->meshes.empty()) {
+            for (auto& [path, texture] : model->textures_loaded) stbi_image_free(texture.data);
+            std::cout << "Failed to load model " << import->path << "\n";
+            import->state = ModelLoadState::Failed;
+        }
+        else {
+            import->model = std::move(model);
+            import->state = ModelLoadState::Uploading;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(completedMutex);
+    completed.push_back(import);
+}
+
+void ModelLoader::discard(BaseRenderer& renderer, Import& import) {
+    if (!import.model) return;
+
+    if (!import.upload.started) {
+        for (auto& [path, texture] : import.model->textures_loaded) stbi_image_free(texture.data);
+    }
+    else {
+        renderer.releaseModelData(*import.model, import.upload);
+    }
+    import.model.reset();
+}
+
+void ModelLoader::updatePlacements(Import& import) {
+    auto cancelled = [&](const Placement& placement) {
+        if (!placement.handle->cancelRequested) return false;
+
+        placement.handle->currentState = ModelLoadState::Cancelled;
+        pending--;
+        return true;
+    };
+    import.placements.erase(std::remove_if(import.placements.begin(), import.placements.end(), cancelled),
+                            import.placements.end());
+
+    if (import.placements.empty()) {
+        import.abandoned = true;
+        return;
+    }
+
+    ModelLoadState state = import.state;
+    for (Placement& placement : import.placements) {
+        placement.handle->currentState = state;
+        placement.handle->currentProgress = import.progress.load();
+    }
+}
+
+bool ModelLoader::update(BaseRenderer& renderer, std::vector<ModelInstance>& ready, double budgetMs) {
+    auto start = std::chrono::steady_clock::now();
+    bool added = false;
+
+    for (auto& [placement, resource] : resident) {
+        if (placement.handle->cancelRequested) {
+            placement.handle->currentState = ModelLoadState::Cancelled;
+        }
+        else {
+            ready.push_back({std::move(resource), placement.modelMatrix});
+            placement.handle->currentProgress = 1.0f;
+            placement.handle->currentState = ModelLoadState::Done;
+            added = true;
+        }
+        pending--;
+    }
+    resident.clear();
+
+    for (auto& [path, import] : imports) {
+        updatePlacements(*import);
+    }
+
+    while (true) {
+        std::shared_ptr<Import> import;
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            if (completed.empty()) break;
+            import = std::move(completed.front());
+            completed.pop_front();
+        }
+
+        auto finish = [&](ModelLoadState state) {
+            for (Placement& placement : import->placements) {
+                placement.handle->currentState = state;
+                pending--;
+            }
+            import->placements.clear();
+
+            auto current = imports.find(import->path);
+            if (current != imports.end() && current->second == import) imports.erase(current);
+        };
+
+        if (import->abandoned || import->state == ModelLoadState::Cancelled) {
+            discard(renderer, *import);
+            finish(ModelLoadState::Cancelled);
+            continue;
+        }
+        if (import->state == ModelLoadState::Failed) {
+            finish(ModelLoadState::Failed);
+            continue;
+        }
+
+        import->model->geometry_residency = import->residency;
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        bool done = renderer.uploadModelData(*import->model, import->upload, budgetMs - elapsed);
+        import->progress = 0.5f + 0.5f * import->upload.progress(*import->model);
+        updatePlacements(*import);
+
+        if (import->abandoned) {
+            discard(renderer, *import);
+            finish(ModelLoadState::Cancelled);
+            continue;
+        }
+        if (!done) {
+            // Picked up again first on the next frame
+            std::lock_guard<std::mutex> lock(completedMutex);
+            completed.push_front(std::move(import));
+            break;
+        }
+
+        // Every load of the path gets its own instance of the one resource
+        resources[import->path] = import->model;
+        for (Placement& placement : import->placements) {
+            ready.push_back({import->model, placement.modelMatrix});
+            placement.handle->currentProgress = 1.0f;
+            added = true;
+        }
+        finish(ModelLoadState::Done);
+
+        elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= budgetMs) break;
+    }
+
+    return added;
+}
+
+bool ModelLoader::idle() const {
+    return pending == 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "assets/model.h"
+#include "core/job_system.h"
+#include "renderer/base_renderer.h"
+
+enum class ModelLoadState {
+    Queued, Importing, Uploading, Done, Cancelled, Failed
+};
+
+// Shared between the caller and the loader, every accessor is safe to call from any thread
+class ModelLoadHandle {
+public:
+    explicit ModelLoadHandle(std::string path) : modelPath(std::move(path)) {}
+
+    ModelLoadState state() const { return currentState; }
+    // 0 to 0.5 while importing on the worker, 0.5 to 1 while uploading on the main thread
+    float progress() const { return currentProgress; }
+    const std::string& path() const { return modelPath; }
+    bool finished() const;
+
+    // Once no other load wants the model either, one that is still importing is dropped once the
+    // import returns and one that is uploading has what already reached the GPU freed
+    void cancel() { cancelRequested = true; }
+    bool cancelled() const { return cancelRequested; }
+
+private:
+    friend class ModelLoader;
+
+    std::string modelPath;
+    std::atomic<ModelLoadState> currentState = ModelLoadState::Queued;
+    std::atomic<float> currentProgress = 0.0f;
+    std::atomic<bool> cancelRequested = false;
+};
+
+// Imports models off the main thread. Everything up to a CPU side ModelResource (assimp import, texture
+// decoding, baking or reading the pack) runs as a job, finished imports are handed back through
+// a queue and the main thread only does the GL uploads, a few milliseconds per frame.
+//
+// Each load places one ModelInstance. A path that is already loaded, or still loading, is not imported
+// again: the new instance shares the resource.
+class ModelLoader {
+public:
+    ModelLoader() = default;
+    ~ModelLoader();
+
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // Main thread only. Loads sharing a model keep the most of its CPU geometry any of them asks for,
+    // a resident model that already released it can't get it back.
+    std::shared_ptr<ModelLoadHandle> load(std::string path, FileType type = OBJ,
+                                          const glm::mat4& modelMatrix = glm::mat4(1.0f),
+                                          GeometryResidency residency = GeometryResidency::Keep);
+
+    // Main thread only. Uploads imported models for at most budgetMs and appends instances of the ones
+    // that are ready to draw to `ready`. Returns true when something was added.
+    bool update(BaseRenderer& renderer, std::vector<ModelInstance>& ready, double budgetMs);
+
+    bool idle() const;
+
+private:
+    // A load waiting for its model
+    struct Placement {
+        std::shared_ptr<ModelLoadHandle> handle;
+        glm::mat4 modelMatrix;
+    };
+
+    // One model being imported and uploaded for every load of its path
+    struct Import {
+        std::string path;
+        FileType type;
+        GeometryResidency residency;
+        // Written by the job, copied to the handles on the main thread
+        std::atomic<ModelLoadState> state = ModelLoadState::Queued;
+        std::atomic<float> progress = 0.0f;
+        // Set once every placement was cancelled, the job skips or drops the model then
+        std::atomic<bool> abandoned = false;
+
+        // Main thread only
+        std::vector<Placement> placements;
+        std::shared_ptr<ModelResource> model;
+        BaseRenderer::ModelUpload upload;
+    };
+
+    void import(const std::shared_ptr<Import>& import);
+    // Frees whatever the model of an import that won't be used holds
+    void discard(BaseRenderer& renderer, Import& import);
+    // Drops cancelled placements and copies the import's state to the rest
+    void updatePlacements(Import& import);
+
+    // Imports that may still be running, only touched on the thread that owns the loader
+    std::vector<JobSystem::JobHandle> jobs;
+    std::unordered_map<std::string, std::shared_ptr<Import>> imports;
+    // Models in use by some instance, by path
+    std::unordered_map<std::string, std::weak_ptr<ModelResource>> resources;
+    // Loads of resident models, turned into instances on the next update
+    std::vector<std::pair<Placement, std::shared_ptr<ModelResource>>> resident;
+
+    mutable std::mutex completedMutex;
+    std::deque<std::shared_ptr<Import>> completed;
+    size_t pending = 0;
+};
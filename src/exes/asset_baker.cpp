@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "assets/model.h"
+#include "core/job_system.h"
+#include "stb_image.h"
+
+// Bakes model packs without a window or GL context, for build machines. Models are given relative to
+// the objects directory, like the paths the demo loads, so the packs land where the demo looks for them.
+//
+// Usage: asset_baker [options] <model or directory>...
+//   --workers N       worker threads, defaults to one per core
+//   --manifest FILE   also bakes the models listed in FILE, one per line, # starts a comment
+//   --objects DIR     directory model paths are relative to, defaults to OBJECT_PATH
+//   --output DIR      directory packs are written to, defaults to ASSET_PATH
+//   --report FILE     JSON report of every model and entry, defaults to bake_report.json in the output directory
+//   --codec [TYPE=]CODEC[:LEVEL]
+//                     codec for mesh, texture or scene blobs, or all of them without TYPE, e.g. texture=lz4hc:12.
+//                     CODEC is none, lz4 or lz4hc, defaults to lz4
+
+namespace {
+    struct BakeJob {
+        std::string path;
+        ModelSource source;
+
+        bool success = false;
+        double bakeTime = 0.0;
+        BakeReport report;
+    };
+
+    bool isModelFile(const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == ".gltf" || extension == ".glb" || extension == ".obj" || extension == ".fbx" ||
+               extension == ".dae";
+    }
+
+    FileType fileTypeFor(const std::string& path) {
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == ".gltf" || extension == ".glb" ? GLTF : OBJ;
+    }
+
+    // Directories are searched recursively, everything else is taken as a model path
+    void collectModels(const std::string& objectsPath, const std::string& input, std::vector<std::string>& models) {
+        std::filesystem::path root(objectsPath);
+        std::error_code error;
+        if (!std::filesystem::is_directory(root / input, error)) {
+            models.push_back(input);
+            return;
+        }
+
+        std::vector<std::string> found;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(root / input, error)) {
+            if (entry.is_regular_file() && isModelFile(entry.path())) {
+                found.push_back(entry.path().lexically_relative(root).generic_string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        models.insert(models.end(), found.begin(), found.end());
+    }
+
+    // Parses one --codec value into the codecs it names
+    bool parseCodecOption(const std::string& value, BlobCodecs& codecs) {
+        size_t separator = value.find('=');
+        assets::CodecSettings settings;
+        if (!assets::parseCodecSettings(separator == std::string::npos ? value : value.substr(separator + 1), settings)) {
+            return false;
+        }
+
+        std::string type = separator == std::string::npos ? "" : value.substr(0, separator);
+        if (type.empty()) codecs = {settings, settings, settings};
+        else if (type == "mesh") codecs.mesh = settings;
+        else if (type == "texture") codecs.texture = settings;
+        else if (type == "scene") codecs.scene = settings;
+        else return false;
+        return true;
+    }
+
+    bool readManifest(const std::string& manifestPath, std::vector<std::string>& inputs) {
+        std::ifstream manifest(manifestPath);
+        if (!manifest) return false;
+
+        std::string line;
+        while (std::getline(manifest, line)) {
+            line = line.substr(0, line.find('#'));
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos) continue;
+            size_t last = line.find_last_not_of(" \t\r");
+            inputs.push_back(line.substr(first, last - first + 1));
+        }
+        return true;
+    }
+
+    void bake(BakeJob& job) {
+        auto start = std::chrono::steady_clock::now();
+        ModelResource model(job.source);
+        job.bakeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        job.report = std::move(model.bake_report);
+        job.success = job.report.success;
+
+        for (auto& [path, texture] : model.textures_loaded) {
+            stbi_image_free(texture.data);
+            texture.data = nullptr;
+        }
+    }
+
+    nlohmann::json reportFor(const BakeJob& job) {
+        size_t rawSize = 0, storedSize = 0;
+        nlohmann::json entries = nlohmann::json::array();
+        for (const BakeReport::Entry& entry : job.report.entries) {
+            rawSize += entry.rawSize;
+            storedSize += entry.storedSize;
+
+            nlohmann::json value;
+            value["type"] = assets::packEntryTypeName(entry.type);
+            value["index"] = entry.index;
+            value["time_ms"] = entry.bakeTime;
+            value["raw_bytes"] = entry.rawSize;
+            value["stored_bytes"] = entry.storedSize;
+            value["ratio"] = entry.storedSize > 0 ? (double) entry.rawSize / entry.storedSize : 0.0;
+            value["reused"] = entry.reused;
+            value["details"] = entry.details;
+            entries.push_back(value);
+        }
+
+        nlohmann::json value;
+        value["model"] = job.path;
+        value["pack"] = job.source.assetPackPath;
+        value["status"] = !job.success ? "failed" : job.report.baked ? "baked" : "current";
+        value["time_ms"] = job.bakeTime;
+        value["raw_bytes"] = rawSize;
+        value["stored_bytes"] = storedSize;
+        value["ratio"] = storedSize > 0 ? (double) rawSize / storedSize : 0.0;
+
+        std::error_code error;
+        uintmax_t packSize = std::filesystem::file_size(job.source.assetPackPath, error);
+        value["pack_bytes"] = error ? 0 : packSize;
+        value["entries"] = entries;
+        return value;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int workers = std::max(std::thread::hardware_concurrency(), 1u);
+    std::string objectsPath = OBJECT_PATH, outputPath = ASSET_PATH, reportPath;
+    std::vector<std::string> inputs;
+    BlobCodecs codecs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--workers" && hasValue) {
+            int count = std::atoi(argv[++i]);
+            if (count <= 0) {
+                std::cout << "--workers needs a positive count\n";
+                return 1;
+            }
+            workers = count;
+        }
+        else if (argument == "--manifest" && hasValue) {
+            if (!readManifest(argv[++i], inputs)) {
+                std::cout << "Could not read manifest " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (argument == "--objects" && hasValue) {
+            objectsPath = argv[++i];
+        }
+        else if (argument == "--output" && hasValue) {
+            outputPath = argv[++i];
+        }
+        else if (argument == "--report" && hasValue) {
+            reportPath = argv[++i];
+        }
+        else if (argument == "--codec" && hasValue) {
+            if (!parseCodecOption(argv[++i], codecs)) {
+                std::cout << "Unknown codec " << argv[i] << ", expected [mesh|texture|scene=]none|lz4|lz4hc[:level]\n";
+                return 1;
+            }
+        }
+        else if (argument.rfind("--", 0) == 0) {
+            std::cout << "Unknown option " << argument << "\n";
+            return 1;
+        }
+        else {
+            inputs.push_back(argument);
+        }
+    }
+
+    if (inputs.empty()) {
+        std::cout << "Usage: asset_baker [--workers N] [--manifest FILE] [--objects DIR] [--output DIR] "
+                     "[--report FILE] [--codec [TYPE=]CODEC[:LEVEL]]... <model or directory>...\n";
+        return 1;
+    }
+    if (!objectsPath.empty() && objectsPath.back() != '/') objectsPath += '/';
+    if (!outputPath.empty() && outputPath.back() != '/') outputPath += '/';
+    if (reportPath.empty()) reportPath = outputPath + "bake_report.json";
+
+    std::error_code error;
+    std::filesystem::create_directories(outputPath, error);
+
+    std::vector<std::string> models;
+    for (const std::string& input : inputs) {
+        collectModels(objectsPath, input, models);
+    }
+    std::sort(models.begin(), models.end());
+    models.erase(std::unique(models.begin(), models.end()), models.end());
+
+    std::vector<BakeJob> jobs(models.size());
+    for (size_t i = 0; i < models.size(); i++) {
+        jobs[i].path = models[i];
+        jobs[i].source = ModelResource::defaultSource(models[i], fileTypeFor(models[i]), objectsPath, outputPath);
+        jobs[i].source.bakeOnly = true;
+        jobs[i].source.codecs = codecs;
+    }
+
+    // Each worker bakes one model at a time, the main thread and waiting bakes help with their meshes
+    // and textures
+    JobSystem::setSharedWorkerCount(workers);
+    JobSystem& jobSystem = JobSystem::shared();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<JobSystem::JobHandle> handles;
+    for (BakeJob& job : jobs) {
+        handles.push_back(jobSystem.scheduleBackground([&job]() { bake(job); }));
+    }
+    jobSystem.wait(handles);
+    double totalTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    nlohmann::json report;
+    nlohmann::json modelReports = nlohmann::json::array();
+    size_t failures = 0;
+    for (const BakeJob& job : jobs) {
+        if (!job.success) {
+            std::cout << "Failed to bake " << job.path << "\n";
+            failures++;
+        }
+        modelReports.push_back(reportFor(job));
+    }
+    report["workers"] = workers;
+    report["codecs"]["mesh"] = assets::codecSettingsName(codecs.mesh);
+    report["codecs"]["texture"] = assets::codecSettingsName(codecs.texture);
+    report["codecs"]["scene"] = assets::codecSettingsName(codecs.scene);
+    report["time_ms"] = totalTime;
+    report["models"] = modelReports;
+    report["failed"] = failures;
+
+    std::ofstream reportFile(reportPath);
+    reportFile << report.dump(2) << "\n";
+    if (!reportFile) {
+        std::cout << "Could not write report " << reportPath << "\n";
+        return 1;
+    }
+
+    std::cout << "Baked " << jobs.size() - failures << " of " << jobs.size() << " models on " << workers
+              << " workers in " << totalTime << " ms, report in " << reportPath << "\n";
+    return failures == 0 ? 0 : 1;
+}
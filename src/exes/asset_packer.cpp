@@ -0,0 +1,83 @@
+#include <filesystem>
+#include <iostream>
+
+#include "assets/asset_converter.h"
+#include "assets/asset_json.h"
+#include "assets/asset_pack.h"
+
+namespace {
+    // Prints the metadata of every entry of a pack, or of a single .object file, as json
+    bool dumpMetadata(const std::string& path) {
+        if (std::filesystem::path(path).extension() == ".pack") {
+            assets::PackReader reader;
+            if (!reader.open(path)) return false;
+
+            for (const assets::PackEntry& entry : reader.getEntries()) {
+                assets::AssetFileView file;
+                if (!reader.view(entry, file)) return false;
+                std::cout << assets::packEntryTypeName(entry.type) << " " << entry.index << ": "
+                          << assets::metadataToJson(file) << "\n";
+            }
+            return true;
+        }
+
+        assets::MappedFile mapping;
+        assets::AssetFileView file;
+        if (!assets::mapBinaryFile(path, mapping, file)) return false;
+        std::cout << assets::metadataToJson(file) << "\n";
+        return true;
+    }
+}
+
+// Converts asset folders written by older builds (main.object + meshes/ + textures/)
+// into single-file packs next to them, e.g. assets/Sponza -> assets/Sponza.pack
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: asset_packer <asset folder>... \n";
+        std::cout << "       asset_packer --all <assets directory>\n";
+        std::cout << "       asset_packer --dump <pack or object file>...\n";
+        return 1;
+    }
+
+    if (std::string(argv[1]) == "--dump") {
+        int failures = 0;
+        for (int i = 2; i < argc; i++) {
+            if (!dumpMetadata(argv[i])) {
+                std::cout << "Failed to read " << argv[i] << "\n";
+                failures++;
+            }
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    std::vector<std::filesystem::path> folders;
+    if (std::string(argv[1]) == "--all" && argc > 2) {
+        for (auto& entry : std::filesystem::directory_iterator(argv[2])) {
+            if (entry.is_directory() && std::filesystem::exists(entry.path() / "main.object")) {
+                folders.push_back(entry.path());
+            }
+        }
+    } else {
+        for (int i = 1; i < argc; i++) {
+            folders.emplace_back(argv[i]);
+        }
+    }
+
+    AssetConverter converter;
+    int failures = 0;
+    for (auto& folder : folders) {
+        std::filesystem::path packPath = folder.lexically_normal();
+        if (!packPath.has_filename()) packPath = packPath.parent_path();
+        packPath += ".pack";
+
+        if (converter.packAssetFolder(folder.string(), packPath.string())) {
+            std::cout << "Packed " << folder.string() << " -> " << packPath.string() << "\n";
+        } else {
+            std::cout << "Failed to pack " << folder.string() << "\n";
+            std::filesystem::remove(packPath);
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "assets/asset_converter.h"
+#include "assets/asset_pack.h"
+#include "assets/block_codec.h"
+
+// Compares block codecs on the mesh and texture payloads of baked packs. Every payload is decoded to
+// its raw bytes, then compressed again with each codec and decoded block by block on one thread, so
+// the decode rate is the codec's own rather than the job system's. Encoding runs on the job system
+// like a bake does.
+//
+// Usage: codec_benchmark [--codec CODEC[:LEVEL]]... <pack>...
+//   Codecs default to none, lz4, lz4hc:3, lz4hc:9 and lz4hc:12.
+
+namespace {
+    struct Sample {
+        const char* type;
+        std::vector<std::vector<char>> payloads;
+        size_t rawSize = 0;
+    };
+
+    void append(std::vector<char>& payload, const void* data, size_t size) {
+        payload.insert(payload.end(), (const char*) data, (const char*) data + size);
+    }
+
+    bool readPack(const std::string& path, AssetConverter& converter, Sample& meshes, Sample& textures) {
+        assets::PackReader reader;
+        if (!reader.open(path)) return false;
+
+        for (const assets::PackEntry& entry : reader.getEntries()) {
+            assets::AssetFileView file;
+            if (!reader.view(entry, file)) return false;
+
+            std::vector<char> payload;
+            if (entry.type == assets::PackEntryType::Mesh) {
+                Mesh mesh;
+                if (!converter.convertBinaryToMesh(file, mesh)) return false;
+                append(payload, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+                append(payload, mesh.packedVertices.data(), mesh.packedVertices.size());
+                append(payload, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned));
+                append(payload, mesh.shortIndices.data(), mesh.shortIndices.size() * sizeof(uint16_t));
+                append(payload, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+                meshes.rawSize += payload.size();
+                meshes.payloads.push_back(std::move(payload));
+            }
+            else if (entry.type == assets::PackEntryType::Texture) {
+                Texture texture;
+                if (!converter.convertBinaryToTexture(file, texture)) return false;
+                append(payload, texture.data, assets::textureDataSize(texture));
+                free(texture.data);
+                textures.rawSize += payload.size();
+                textures.payloads.push_back(std::move(payload));
+            }
+        }
+        return true;
+    }
+
+    struct Result {
+        size_t storedSize = 0;
+        double encodeTime = 0.0;
+        double decodeTime = INFINITY;
+    };
+
+    Result measure(const Sample& sample, const assets::CodecSettings& settings) {
+        const assets::CodecInfo* codec = assets::findCodec(settings.codec);
+        Result result;
+
+        std::vector<std::vector<char>> blobs(sample.payloads.size());
+        std::vector<std::vector<uint32_t>> storedSizes(sample.payloads.size());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < sample.payloads.size(); i++) {
+            const std::vector<char>& payload = sample.payloads[i];
+            storedSizes[i] = assets::compressBlocks(blobs[i], payload.data(), payload.size(), settings);
+            result.storedSize += blobs[i].size();
+        }
+        result.encodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<char> decoded(assets::BLOCK_SIZE);
+        for (int run = 0; run < 3; run++) {
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < sample.payloads.size(); i++) {
+                size_t size = sample.payloads[i].size();
+                const char* source = blobs[i].data();
+                for (size_t block = 0; block < storedSizes[i].size(); block++) {
+                    size_t rawSize = std::min(assets::BLOCK_SIZE, size - block * assets::BLOCK_SIZE);
+                    if (!codec->decompress(source, storedSizes[i][block], decoded.data(), rawSize)) {
+                        std::cout << "Decoding failed with " << assets::codecSettingsName(settings) << "\n";
+                        std::exit(1);
+                    }
+                    source += storedSizes[i][block];
+                }
+            }
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            result.decodeTime = std::min(result.decodeTime, time);
+        }
+        return result;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<assets::CodecSettings> codecs;
+    std::vector<std::string> packs;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--codec" && i + 1 < argc) {
+            assets::CodecSettings settings;
+            if (!assets::parseCodecSettings(argv[++i], settings)) {
+                std::cout << "Unknown codec " << argv[i] << "\n";
+                return 1;
+            }
+            codecs.push_back(settings);
+        }
+        else {
+            packs.push_back(argument);
+        }
+    }
+    if (packs.empty()) {
+        std::cout << "Usage: codec_benchmark [--codec CODEC[:LEVEL]]... <pack>...\n";
+        return 1;
+    }
+    if (codecs.empty()) {
+        codecs = {{assets::Codec::None}, {assets::Codec::LZ4}, {assets::Codec::LZ4HC, 3}, {assets::Codec::LZ4HC, 9},
+                  {assets::Codec::LZ4HC, 12}};
+    }
+
+    AssetConverter converter;
+    Sample meshes{"mesh", {}}, textures{"texture", {}};
+    for (const std::string& pack : packs) {
+        if (!readPack(pack, converter, meshes, textures)) {
+            std::cout << "Could not read " << pack << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << std::left << std::setw(10) << "type" << std::setw(12) << "codec" << std::setw(14) << "raw MB"
+              << std::setw(14) << "stored MB" << std::setw(10) << "ratio" << std::setw(14) << "encode MB/s"
+              << "decode GB/s\n";
+    std::cout << std::fixed;
+
+    for (const Sample* sample : {&meshes, &textures}) {
+        if (sample->rawSize == 0) continue;
+
+        for (const assets::CodecSettings& settings : codecs) {
+            Result result = measure(*sample, settings);
+            double raw = (double) sample->rawSize;
+            std::cout << std::setw(10) << sample->type << std::setw(12) << assets::codecSettingsName(settings)
+                      << std::setprecision(2) << std::setw(14) << raw / 1e6 << std::setw(14) << result.storedSize / 1e6
+                      << std::setprecision(3) << std::setw(10) << raw / std::max<size_t>(result.storedSize, 1)
+                      << std::setprecision(1) << std::setw(14) << raw / 1e6 / result.encodeTime
+                      << std::setprecision(2) << raw / 1e9 / result.decodeTime << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/job_system.h"
+
+// Measures how the job system scales with thread count on three kinds of work: a parallelFor over
+// expensive items, a parallelFor over tiny items where scheduling overhead dominates, and a task
+// graph of dependent chains. Usage: job_benchmark [thread counts...], defaults to 1 4 8 16 32.
+
+namespace {
+    // Enough floating point work per item that one item is tens of microseconds
+    float expensiveItem(size_t index) {
+        float value = (float) index;
+        for (int i = 0; i < 20000; i++) {
+            value = std::sin(value) * 0.5f + std::sqrt(std::abs(value) + 1.0f);
+        }
+        return value;
+    }
+
+    float coarseFor(JobSystem& jobs) {
+        std::vector<float> results(2048);
+        jobs.parallelFor(results.size(), [&](size_t i) { results[i] = expensiveItem(i); });
+        return results[results.size() / 2];
+    }
+
+    float fineFor(JobSystem& jobs) {
+        std::vector<float> values(1 << 22);
+        jobs.parallelFor(values.size(), [&](size_t i) { values[i] = std::sqrt((float) i); });
+        return values[values.size() / 2];
+    }
+
+    // 64 independent chains of 16 jobs, each job waits for the previous one in its chain
+    float taskGraph(JobSystem& jobs) {
+        constexpr size_t CHAINS = 64, LENGTH = 16;
+        std::vector<float> state(CHAINS, 0.0f);
+        std::vector<JobSystem::JobHandle> tails(CHAINS);
+
+        for (size_t step = 0; step < LENGTH; step++) {
+            for (size_t chain = 0; chain < CHAINS; chain++) {
+                tails[chain] = jobs.schedule([&state, chain, step]() {
+                    state[chain] += expensiveItem(chain * LENGTH + step) * 0.001f;
+                }, {tails[chain]});
+            }
+        }
+        jobs.wait(tails);
+        return state[0];
+    }
+
+    double bestOf(int runs, JobSystem& jobs, float (*workload)(JobSystem&), float& sink) {
+        double best = INFINITY;
+        for (int run = 0; run < runs; run++) {
+            auto start = std::chrono::steady_clock::now();
+            sink += workload(jobs);
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<unsigned int> threadCounts;
+    for (int i = 1; i < argc; i++) {
+        int count = std::atoi(argv[i]);
+        if (count <= 0) {
+            std::cout << "Usage: job_benchmark [thread counts...]\n";
+            return 1;
+        }
+        threadCounts.push_back(count);
+    }
+    if (threadCounts.empty()) {
+        threadCounts = {1, 4, 8, 16, 32};
+    }
+
+    struct Workload {
+        const char* name;
+        float (*run)(JobSystem&);
+    };
+    const Workload workloads[] = {
+        {"coarse for", coarseFor},
+        {"fine for", fineFor},
+        {"task graph", taskGraph},
+    };
+
+    unsigned int cores = std::thread::hardware_concurrency();
+    std::cout << "Hardware threads: " << cores << "\n";
+    std::cout << std::left << std::setw(10) << "threads";
+    for (const Workload& workload : workloads) {
+        std::cout << std::setw(26) << (std::string(workload.name) + " ms (speedup)");
+    }
+    std::cout << "\n";
+
+    std::vector<double> baseline;
+    float sink = 0.0f;
+    for (unsigned int threads : threadCounts) {
+        // The calling thread helps, so n threads is n - 1 workers
+        JobSystem jobs(threads - 1);
+        std::cout << std::setw(10) << (std::to_string(threads) + (threads > cores ? "*" : ""));
+
+        for (size_t i = 0; i < std::size(workloads); i++) {
+            double time = bestOf(5, jobs, workloads[i].run, sink);
+            if (baseline.size() <= i) baseline.push_back(time);
+
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(2) << time << " (" << std::setprecision(1)
+                 << baseline[i] / time << "x)";
+            std::cout << std::setw(26) << cell.str();
+        }
+        std::cout << "\n";
+    }
+
+    if (threadCounts.back() > cores) {
+        std::cout << "* more threads than the machine has, expect no further scaling\n";
+    }
+    // Keeps the workloads from being optimized away
+    return sink == 12345.0f ? 2 : 0;
+}
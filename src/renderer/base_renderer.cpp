@@ -1,10 +1,13 @@
 #include "base_renderer.h"
 #include "utils/functions.h"
+#include "assets/meshlet.h"
+#include "assets/texture_registry.h"
+#include "core/job_system.h"
 #include "stb_image.h"
 
 #include <SDL.h>
-#include <thread>
-#include <future>
+#include <chrono>
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "imgui/imgui.h"
@@ -18,16 +21,22 @@ void BaseRenderer::init_resources() {
 }
 
 void BaseRenderer::subscribePrograms(UpdateListener&listener) {}
-void BaseRenderer::handleObjs(std::vector<Model>& objs) {}
+void BaseRenderer::handleObjs(std::vector<ModelInstance>& objs) {}
 
-void BaseRenderer::drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions) const {
+void BaseRenderer::drawModels(std::vector<ModelInstance>& models, Shader& shader, unsigned char drawOptions) const {
     bool shouldSkipTextures = drawOptions & SKIP_TEXTURES;
     bool shouldSkipCulling = drawOptions & SKIP_CULLING;
 
-    for (Model& model : models) {
+    glm::mat4 viewProjection = camera->getProjectionMatrix() * camera->getViewMatrix();
+    std::vector<assets::IndexRange> visibleRanges;
+    std::vector<GLsizei> rangeCounts;
+    std::vector<const void*> rangeOffsets;
+
+    for (ModelInstance& instance : models) {
+        ModelResource& model = *instance.resource;
         if (!shouldSkipCulling) {
-            glm::vec4 transformedMax = model.model_matrix * model.aabb.maxPoint;
-            glm::vec4 transformedMin = model.model_matrix * model.aabb.minPoint;
+            glm::vec4 transformedMax = instance.model_matrix * model.aabb.maxPoint;
+            glm::vec4 transformedMin = instance.model_matrix * model.aabb.minPoint;
             bool shouldDraw = camera->isInsideFrustum(transformedMax, transformedMin);
             if (!shouldDraw) continue;
         }
@@ -35,7 +44,7 @@ void BaseRenderer::drawModels(std::vector<Model>& models, Shader& shader, unsign
         for (int j = 0; j < model.meshes.size(); j++) {
             Mesh& mesh = model.meshes[j];
 
-            glm::mat4 finalModelMatrix = mesh.model_matrix * model.model_matrix;
+            glm::mat4 finalModelMatrix = mesh.model_matrix * instance.model_matrix;
             if (!shouldSkipCulling) {
                 glm::vec4 meshMin = finalModelMatrix * mesh.aabb.minPoint;
                 glm::vec4 meshMax = finalModelMatrix * mesh.aabb.maxPoint;
@@ -44,8 +53,15 @@ void BaseRenderer::drawModels(std::vector<Model>& models, Shader& shader, unsign
             }
 
             shader.setMat4("model", finalModelMatrix);
+
+            bool isPacked = mesh.vertexFormat == assets::VertexFormat::Quantized16;
+            shader.setBool("packedVertices", isPacked);
+            if (isPacked) {
+                shader.setVec3("positionScale", assets::quantizationScale(mesh.aabb));
+                shader.setVec3("positionOffset", assets::quantizationOffset(mesh.aabb));
+            }
             if (!shouldSkipTextures) {
-                Material material = model.materials_loaded[mesh.materialIndex];
+                const Material& material = model.materials_loaded[mesh.materialIndex];
 
                 if (material.textures.size() != 4) {
                     shader.setBool("noMetallicMap", true);
@@ -70,61 +86,285 @@ void BaseRenderer::drawModels(std::vector<Model>& models, Shader& shader, unsign
                 glActiveTexture(GL_TEXTURE0);
 
                 Animation& currentAnimationData = model.animations[j];
-                if (!currentAnimationData.bone_data.empty() && model.scene->mNumAnimations > 0) {
+                if (currentAnimationData.animationSSBO != 0 && (size_t) instance.animation < model.animation_clips.size()) {
                     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, currentAnimationData.animationSSBO);
 
-                    auto finalTransforms = currentAnimationData.getBoneTransforms(animationTime, model.scene, model.nodes, chosenAnimation);
+                    auto finalTransforms = currentAnimationData.getBoneTransforms(animationTime + instance.animationOffset,
+                        model.animation_clips[instance.animation], model.nodes);
                     for (unsigned int i = 0; i < finalTransforms.size(); i++) {
                         shader.setMat4("boneMatrices[" + std::to_string(i) + "]", finalTransforms[i]);
                     }
                 }
             }
 
+            size_t indexOffset = 0, indexCount = mesh.indexCount();
+            if (const MeshLod* lod = selectLod(mesh, finalModelMatrix)) {
+                indexOffset = lod->indexOffset;
+                indexCount = lod->indexCount;
+            }
+
+            GLenum indexType = glutil::indexTypeToGL(mesh.indexType);
+            size_t indexSize = assets::indexTypeSize(mesh.indexType);
             glBindVertexArray(mesh.buffer.VAO);
-            glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, nullptr);
+
+            // Meshlets split the full resolution level, so big meshes only draw the clusters facing the camera.
+            // Their bounds are in the bind pose, so animated meshes are drawn whole.
+            bool animated = (size_t) j < model.animations.size() && model.animations[j].animationSSBO != 0;
+            if (!shouldSkipCulling && !mesh.meshlets.empty() && indexOffset == 0 && !animated) {
+                glm::vec4 planes[6];
+                assets::extractFrustumPlanes(viewProjection * finalModelMatrix, planes);
+                glm::vec3 cameraPosition = glm::inverse(finalModelMatrix) * glm::vec4(camera->Position, 1.0f);
+
+                visibleRanges.clear();
+                assets::cullMeshlets(mesh.meshlets, planes, cameraPosition, visibleRanges);
+
+                rangeCounts.clear();
+                rangeOffsets.clear();
+                for (const assets::IndexRange& range : visibleRanges) {
+                    rangeCounts.push_back(static_cast<GLsizei>(range.count));
+                    rangeOffsets.push_back(reinterpret_cast<const void*>(range.offset * indexSize));
+                }
+
+                if (!visibleRanges.empty()) {
+                    glMultiDrawElements(GL_TRIANGLES, rangeCounts.data(), indexType, rangeOffsets.data(),
+                        static_cast<GLsizei>(rangeCounts.size()));
+                }
+            }
+            else {
+                glDrawElements(GL_TRIANGLES, indexCount, indexType, reinterpret_cast<const void*>(indexOffset * indexSize));
+            }
             glBindVertexArray(0);
         }
     }
 }
 
-void BaseRenderer::loadModelData(Model& model) {
-    for (auto& info : model.textures_loaded) {
-        Texture& texture = info.second;
+const MeshLod* BaseRenderer::selectLod(const Mesh& mesh, const glm::mat4& modelMatrix) const {
+    if (mesh.lods.empty()) {
+        return nullptr;
+    }
+
+    // Bounding sphere of the transformed AABB, errors scale with the largest axis of the transform
+    glm::vec3 center = modelMatrix * glm::vec4(glm::vec3(mesh.aabb.maxPoint + mesh.aabb.minPoint) * 0.5f, 1.0f);
+    float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+        glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    float radius = glm::length(glm::vec3(mesh.aabb.maxPoint - mesh.aabb.minPoint)) * 0.5f * scale;
+    float distance = glm::length(center - camera->Position) - radius;
+
+    const MeshLod* chosen = &mesh.lods[0];
+    for (const MeshLod& lod : mesh.lods) {
+        if (camera->projectedSize(lod.error * scale, distance, windowSize.y) > lodErrorThreshold) break;
+        chosen = &lod;
+    }
+    return chosen;
+}
+
+void BaseRenderer::loadModelData(ModelResource& model) {
+    ModelUpload upload;
+    while (!uploadModelData(model, upload, INFINITY)) {
+        uploads.flushUntil(upload.lastTicket);
+    }
+}
+
+bool BaseRenderer::uploadModelData(ModelResource& model, ModelUpload& upload, double budgetMs) {
+    if (!upload.started) {
+        for (auto& info : model.textures_loaded) {
+            upload.textures.push_back(&info.second);
+        }
+        upload.started = true;
+    }
+
+    // Always make progress, even when a single resource takes longer than the budget
+    auto start = std::chrono::steady_clock::now();
+    auto withinBudget = [&]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < budgetMs;
+    };
+
+    while (upload.nextTexture < upload.textures.size()) {
+        uploadTexture(model, *upload.textures[upload.nextTexture++], upload);
+        if (!withinBudget()) return false;
+    }
+    while (upload.nextMesh < model.meshes.size()) {
+        uploadMesh(model.meshes[upload.nextMesh++], upload);
+        if (!withinBudget()) return false;
+    }
+
+    if (!upload.queued) {
+        for (Material& material : model.materials_loaded) {
+            material.textures.clear();
+            material.texture_handles.clear();
+            for (std::string& path : material.texture_paths) {
+                Texture& texture = model.textures_loaded[path];
+                material.textures.push_back(texture);
+
+                auto handle = model.texture_handles.find(path);
+                material.texture_handles.push_back(handle != model.texture_handles.end() ? handle->second : nullptr);
+            }
+        }
+
+        for (Animation& animationData: model.animations) {
+            if (!animationData.bone_data.empty() && model.numAnimations > 0) {
+                glCreateBuffers(1, &animationData.animationSSBO);
+                glNamedBufferStorage(animationData.animationSSBO, sizeof(VertexBoneData) * animationData.bone_data.size(),
+                    animationData.bone_data.data(), GL_DYNAMIC_STORAGE_BIT);
+            }
+        }
+        upload.queued = true;
+    }
+
+    // Not drawable until the upload manager has issued every copy into its buffers and textures
+    if (!uploads.isComplete(upload.lastTicket)) {
+        return false;
+    }
+    for (unsigned char* data : upload.pendingFrees) {
+        stbi_image_free(data);
+    }
+    upload.pendingFrees.clear();
+    model.releaseGeometry();
+
+    upload.finished = true;
+    return true;
+}
+
+float BaseRenderer::ModelUpload::progress(const ModelResource& model) const {
+    size_t total = textures.size() + model.meshes.size();
+    if (finished || total == 0) return finished ? 1.0f : 0.0f;
+    return (float) (nextTexture + nextMesh) / total;
+}
+
+void BaseRenderer::uploadTexture(ModelResource& model, Texture& texture, ModelUpload& upload) {
+    // Textures another model already uploaded are used as they are
+    assets::TextureRegistry& registry = assets::TextureRegistry::shared();
+    auto pinned = model.texture_handles.find(texture.path);
+    assets::TextureHandle shared = pinned != model.texture_handles.end() ? pinned->second : registry.find(texture.contentKey);
+    if (shared) {
+        stbi_image_free(texture.data);
+        std::string path = std::move(texture.path);
+        texture = shared->texture;
+        texture.path = std::move(path);
+        model.texture_handles[texture.path] = shared;
+        return;
+    }
+
+    unsigned int textureID = 0;
+    uint64_t ticket = 0;
+    if (streamTextures && !model.asset_pack_path.empty()) {
+        textureID = textureStreamer.registerTexture(model.asset_pack_path, texture, ticket);
+    }
+
+    // Baked textures bring their own mips, only older assets still get them generated here
+    if (textureID != 0) {
+        // Streamed, only the coarse levels are resident for now
+    }
+    else if (texture.compression != TextureCompression::None || texture.mipLevels > 1) {
+        textureID = glutil::createTextureStorage(texture.width, texture.height, texture.compression,
+            texture.nrComponents, texture.mipLevels);
+
+        const unsigned char* levelData = texture.data;
+        for (int level = 0; level < texture.mipLevels && textureID != 0; level++) {
+            UploadManager::TextureRegion region;
+            region.texture = textureID;
+            region.level = level;
+            region.width = assets::mipDimension(texture.width, level);
+            region.height = assets::mipDimension(texture.height, level);
+            region.compression = texture.compression;
+            region.nrComponents = texture.nrComponents;
+
+            ticket = uploads.uploadToTexture(region, levelData);
+            levelData += assets::textureLevelSize(texture, level);
+        }
+    }
+    else {
+        // Mips are generated from level 0 right away, so these can't wait for the staging ring
         int levels = (texture.type == "texture_normal" || texture.width < 16) ? 1 : 4;
-        unsigned int textureID = glutil::createTexture(texture.width, texture.height,
+        textureID = glutil::createTexture(texture.width, texture.height,
             GL_UNSIGNED_BYTE, texture.nrComponents, texture.data, levels);
+    }
 
-        texture.id = textureID;
+    texture.id = textureID;
+    if (textureID != 0 && texture.contentKey != 0) {
+        model.texture_handles[texture.path] = registry.add(texture.contentKey, texture);
+    }
 
+    if (ticket != 0) {
+        upload.lastTicket = std::max(upload.lastTicket, ticket);
+        upload.pendingFrees.push_back(texture.data);
+    }
+    else {
         stbi_image_free(texture.data);
     }
+}
+
+void BaseRenderer::uploadMesh(Mesh& mesh, ModelUpload& upload) {
+    // Buffers are created empty and filled through the staging ring
+    size_t indexBytes = assets::indexTypeSize(mesh.indexType) * mesh.indexCount();
+    if (mesh.vertexFormat == assets::VertexFormat::Quantized16) {
+        mesh.buffer = glutil::loadVertexBuffer(static_cast<const assets::PackedVertex*>(nullptr),
+            mesh.vertexCount(), nullptr, mesh.indexCount(), mesh.indexType);
+        uploads.uploadToBuffer(mesh.buffer.VBO, 0, mesh.packedVertices.data(), mesh.packedVertices.size());
+    }
+    else {
+        std::vector<VertexType> endpoints = { POSITION, NORMAL, TEXCOORDS, TANGENT, BI_TANGENT, VERTEX_ID };
+        mesh.buffer = glutil::loadVertexBuffer(static_cast<const Vertex*>(nullptr), mesh.vertices.size(), nullptr,
+            mesh.indexCount(), mesh.indexType, endpoints);
+        uploads.uploadToBuffer(mesh.buffer.VBO, 0, mesh.vertices.data(), sizeof(Vertex) * mesh.vertices.size());
+    }
+
+    upload.lastTicket = std::max(upload.lastTicket, uploads.uploadToBuffer(mesh.buffer.EBO, 0, mesh.indexData(), indexBytes));
+}
+
+void BaseRenderer::releaseModelData(ModelResource& model, const ModelUpload& upload) {
+    // Queued copies still point at these objects and at the model's memory
+    uploads.flushUntil(upload.lastTicket);
+
+    // Registered textures are deleted by the registry once no other model holds them either
+    for (size_t i = 0; i < upload.nextTexture; i++) {
+        Texture& texture = *upload.textures[i];
+        if (model.texture_handles.count(texture.path) != 0) continue;
 
+        textureStreamer.unregisterTexture(texture.id);
+        glDeleteTextures(1, &texture.id);
+    }
+    model.texture_handles.clear();
     for (Material& material : model.materials_loaded) {
-        for (std::string& path : material.texture_paths) {
-            Texture& texture = model.textures_loaded[path];
-            material.textures.push_back(texture);
-        }
+        material.texture_handles.clear();
+    }
+    for (unsigned char* data : upload.pendingFrees) {
+        stbi_image_free(data);
+    }
+    // Textures that never made it to the GPU still own their decoded pixels
+    for (size_t i = upload.nextTexture; i < upload.textures.size(); i++) {
+        stbi_image_free(upload.textures[i]->data);
+        upload.textures[i]->data = nullptr;
     }
 
-    for (Mesh& mesh : model.meshes) {
-        std::vector<VertexType> endpoints = { POSITION, NORMAL, TEXCOORDS, TANGENT, BI_TANGENT, VERTEX_ID };
-        mesh.buffer = glutil::loadVertexBuffer(mesh.vertices, mesh.indices, endpoints);
+    for (size_t i = 0; i < upload.nextMesh; i++) {
+        AllocatedBuffer& buffer = model.meshes[i].buffer;
+        glDeleteVertexArrays(1, &buffer.VAO);
+        glDeleteBuffers(1, &buffer.VBO);
+        glDeleteBuffers(1, &buffer.EBO);
     }
 
-    for (Animation& animationData: model.animations) {
-        if (!animationData.bone_data.empty() && model.scene->mNumAnimations > 0) {
-            glCreateBuffers(1, &animationData.animationSSBO);
-            glNamedBufferStorage(animationData.animationSSBO, sizeof(VertexBoneData) * animationData.bone_data.size(),
-                animationData.bone_data.data(), GL_DYNAMIC_STORAGE_BIT);
+    if (upload.queued) {
+        for (Animation& animationData : model.animations) {
+            if (animationData.animationSSBO != 0) glDeleteBuffers(1, &animationData.animationSSBO);
         }
     }
 }
 
-void BaseRenderer::checkFrustum(std::vector<Model>& objs) const {
-    for (Model& model : objs) {
-        glm::vec4 transformedMax = model.model_matrix * model.aabb.maxPoint;
-        glm::vec4 transformedMin = model.model_matrix * model.aabb.minPoint;
-
-        model.shouldDraw = camera->isInsideFrustum(transformedMax, transformedMin);
+void BaseRenderer::releaseUnusedTextures() {
+    for (unsigned int id : assets::TextureRegistry::shared().collectUnused()) {
+        textureStreamer.unregisterTexture(id);
+        glDeleteTextures(1, &id);
     }
+}
+
+void BaseRenderer::checkFrustum(std::vector<ModelInstance>& objs) const {
+    // Only scenes with a lot of instances are worth spreading over the job system
+    JobSystem::shared().parallelFor(objs.size(), [&](size_t i) {
+        ModelInstance& instance = objs[i];
+        glm::vec4 transformedMax = instance.model_matrix * instance.resource->aabb.maxPoint;
+        glm::vec4 transformedMin = instance.model_matrix * instance.resource->aabb.minPoint;
+
+        instance.shouldDraw = camera->isInsideFrustum(transformedMax, transformedMin);
+    }, 256);
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include "utils/camera.h"
 #include "assets/model.h"
 #include "utils/common_primitives.h"
+#include "renderer/texture_streamer.h"
+#include "renderer/upload_manager.h"
 
 #include "ui/editor.h"
 
@@ -17,13 +19,30 @@ enum DrawOptions {
 
 class BaseRenderer {
 public:
+    // Where an incremental upload of a model stopped, textures go first, then meshes
+    struct ModelUpload {
+        std::vector<Texture*> textures;
+        size_t nextTexture = 0, nextMesh = 0;
+        bool started = false, queued = false, finished = false;
+        // Copies read from the model's memory until this ticket completes, pixels are freed after that
+        uint64_t lastTicket = 0;
+        std::vector<unsigned char*> pendingFrees;
+
+        float progress(const ModelResource& model) const;
+    };
+
     virtual ~BaseRenderer() = default;
 
     virtual void init_resources();
-    virtual void handleObjs(std::vector<Model>& objs);
-    void loadModelData(Model& model);
+    virtual void handleObjs(std::vector<ModelInstance>& objs);
+    void loadModelData(ModelResource& model);
+    // Uploads textures and meshes until budgetMs runs out, returns true once the model is ready to draw.
+    // CPU geometry the model's geometry_residency doesn't keep is released then.
+    bool uploadModelData(ModelResource& model, ModelUpload& upload, double budgetMs);
+    // Frees whatever an unfinished or finished upload already created on the GPU
+    void releaseModelData(ModelResource& model, const ModelUpload& upload);
 
-    virtual void render(std::vector<Model>& objs) = 0;
+    virtual void render(std::vector<ModelInstance>& objs) = 0;
     virtual void handleImGui() = 0;
 
     virtual void subscribePrograms(UpdateListener& listener);
@@ -31,6 +50,14 @@ public:
     Camera* camera = nullptr;
     int WINDOW_WIDTH = 1920, WINDOW_HEIGHT = 1080;
     glm::ivec2 windowSize = glm::ivec2(WINDOW_WIDTH, WINDOW_HEIGHT);
+    // Coarsest LOD whose simplification error projects below this many pixels gets drawn
+    float lodErrorThreshold = 1.0f;
+
+    // Every buffer and texture upload of loaded models goes through here, flushed once per frame
+    UploadManager uploads;
+    // Baked textures only keep the mips their on-screen size needs resident
+    bool streamTextures = true;
+    TextureStreamer textureStreamer{uploads};
 
     ScreenQuad screenQuad;
     EnviornmentCubemap cubemap;
@@ -38,8 +65,14 @@ public:
 protected:
     float startTime = 0.0f;
     float animationTime = 0.0f;
-    int chosenAnimation = 0;
 
-    void drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions = 0) const;
-    void checkFrustum(std::vector<Model>& objs) const;
+    void drawModels(std::vector<ModelInstance>& models, Shader& shader, unsigned char drawOptions = 0) const;
+    void checkFrustum(std::vector<ModelInstance>& objs) const;
+    const MeshLod* selectLod(const Mesh& mesh, const glm::mat4& modelMatrix) const;
+    // Deletes textures the registry gave up because no loaded model uses them any more, once a frame
+    void releaseUnusedTextures();
+
+private:
+    void uploadTexture(ModelResource& model, Texture& texture, ModelUpload& upload);
+    void uploadMesh(Mesh& mesh, ModelUpload& upload);
 };
\ No newline at end of file
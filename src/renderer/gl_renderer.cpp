@@ -6,6 +6,7 @@
 #include <glm/gtx/string_cast.hpp>
 
 void GLRenderer::init_resources() {
+    uploads.init();
     starterPipeline = Shader("default/default.vs", "default/default.fs");
 
     planeBuffer = glutil::createPlane();
@@ -19,9 +20,12 @@ void GLRenderer::subscribePrograms(UpdateListener& listener) {
 }
 
 
-void GLRenderer::render(std::vector<Model>& objs) {
+void GLRenderer::render(std::vector<ModelInstance>& objs) {
     auto currentFrame = static_cast<float>(SDL_GetTicks());
     animationTime = (currentFrame - startTime) / 1000.0f;
+    releaseUnusedTextures();
+    textureStreamer.update(objs, *camera, static_cast<float>(windowSize.y));
+    uploads.flush();
 
     glm::mat4 proj = camera->getProjectionMatrix();
     glm::mat4 view = camera->getViewMatrix();
@@ -40,7 +44,7 @@ void GLRenderer::render(std::vector<Model>& objs) {
     screenQuad.draw();
 }
 
-void GLRenderer::renderScene(std::vector<Model>& objs, Shader& shader, bool skipTextures) {
+void GLRenderer::renderScene(std::vector<ModelInstance>& objs, Shader& shader, bool skipTextures) {
     drawModels(objs, shader, skipTextures & SKIP_TEXTURES);
 
     auto planeModel = glm::mat4(1.0f);
@@ -60,4 +64,28 @@ void GLRenderer::handleImGui() {
 
     if (ImGui::CollapsingHeader("Start Here")) {
     }
+    if (ImGui::CollapsingHeader("Texture Streaming")) {
+        ImGui::Text("%zu textures, %.1f MB resident", textureStreamer.streamedTextureCount(),
+            textureStreamer.residentBytes() / (1024.0 * 1024.0));
+        ImGui::SliderFloat("Mip bias", &textureStreamer.mipBias, -2.0f, 4.0f);
+    }
+    if (ImGui::CollapsingHeader("Shared Textures")) {
+        assets::TextureRegistry& registry = assets::TextureRegistry::shared();
+        ImGui::Text("%zu textures registered, %zu loads reused one", registry.textureCount(), registry.reuseCount());
+    }
+    if (ImGui::CollapsingHeader("Geometry Memory")) {
+        ImGui::Text("%.1f MB of CPU geometry resident", ModelResource::residentGeometryBytes() / (1024.0 * 1024.0));
+        ImGui::Text("%.1f MB released after upload", ModelResource::releasedGeometryBytes() / (1024.0 * 1024.0));
+    }
+    if (ImGui::CollapsingHeader("Uploads")) {
+        ImGui::Text("%.1f / %.1f MB staging in use", uploads.usedBytes() / (1024.0 * 1024.0),
+            uploads.capacity() / (1024.0 * 1024.0));
+        ImGui::Text("%.1f MB copied last frame, %.1f MB queued", uploads.lastFrameBytes() / (1024.0 * 1024.0),
+            uploads.queuedBytes() / (1024.0 * 1024.0));
+
+        int budgetMB = static_cast<int>(uploads.frameBudget / (1024 * 1024));
+        if (ImGui::SliderInt("Budget per frame (MB)", &budgetMB, 1, 64)) {
+            uploads.frameBudget = static_cast<size_t>(budgetMB) * 1024 * 1024;
+        }
+    }
 }
@@ -6,7 +6,7 @@ class GLRenderer : public BaseRenderer {
 public:
     void init_resources() override;
     void subscribePrograms(UpdateListener& listener) override;
-    void render(std::vector<Model>& objs) override;
+    void render(std::vector<ModelInstance>& objs) override;
     void handleImGui() override;
 
 private:
@@ -15,5 +15,5 @@ private:
 
     Shader starterPipeline;
 
-    void renderScene(std::vector<Model>& objs, Shader& shader, bool skipTextures);
+    void renderScene(std::vector<ModelInstance>& objs, Shader& shader, bool skipTextures);
 };
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "assets/asset_cache.h"
+#include "assets/texture_compression.h"
+#include "assets/texture_mips.h"
+#include "core/job_system.h"
+#include "utils/functions.h"
+
+TextureStreamer::~TextureStreamer() {
+    // Pending decodes read from the packs owned here, and staging space they got is given back
+    for (auto& [id, texture] : textures) {
+        if (texture.pending.valid()) texture.decoded = texture.pending.get();
+        uploads.release(texture.decoded.staged);
+    }
+}
+
+std::shared_ptr<const assets::PackReader> TextureStreamer::openPack(const std::string& path) {
+    std::error_code error;
+    std::filesystem::file_time_type modifiedTime = std::filesystem::last_write_time(path, error);
+    if (error) return nullptr;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error) return nullptr;
+
+    // A pack rebaked since it was mapped is opened again, textures registered from the old one keep it
+    OpenPack& open = packs[path];
+    std::shared_ptr<const assets::PackReader> pack = open.reader.lock();
+    if (pack && open.modifiedTime == modifiedTime && open.size == size) {
+        return pack;
+    }
+
+    auto reader = std::make_shared<assets::PackReader>();
+    if (!reader->open(path)) {
+        return nullptr;
+    }
+    open = {reader, modifiedTime, size};
+    return reader;
+}
+
+unsigned int TextureStreamer::registerTexture(const std::string& packPath, const Texture& texture, uint64_t& uploadTicket) {
+    if (texture.mipLevels <= 1 || texture.data == nullptr) {
+        return 0;
+    }
+
+    std::shared_ptr<const assets::PackReader> pack = openPack(packPath);
+    const assets::PackEntry* entry = pack ? pack->findByKey(assets::PackEntryType::Texture,
+                                                           assets::hashString(texture.path)) : nullptr;
+    GLenum internalFormat, format;
+    if (entry == nullptr || !glutil::textureFormats(texture.compression, texture.nrComponents, internalFormat, format)) {
+        return 0;
+    }
+
+    StreamedTexture streamed;
+    streamed.layout = texture;
+    streamed.layout.data = nullptr;
+    streamed.pack = pack;
+    streamed.entry = *entry;
+    streamed.lastNeeded.assign(texture.mipLevels, 0);
+
+    streamed.tailLevel = texture.mipLevels - 1;
+    while (streamed.tailLevel > 0 &&
+           std::max(assets::mipDimension(texture.width, streamed.tailLevel - 1),
+                    assets::mipDimension(texture.height, streamed.tailLevel - 1)) <= residentTailSize) {
+        streamed.tailLevel--;
+    }
+
+    unsigned int id;
+    glCreateTextures(GL_TEXTURE_2D, 1, &id);
+    glTextureParameteri(id, GL_TEXTURE_MAX_LEVEL, texture.mipLevels - 1);
+    glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (texture.compression == TextureCompression::BC4) {
+        GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        glTextureParameteriv(id, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    // The model isn't drawn before uploadTicket completes, so the base can point at the tail right away
+    const unsigned char* levelData = texture.data;
+    for (int level = 0; level < texture.mipLevels; level++) {
+        if (level >= streamed.tailLevel) {
+            uploadTicket = uploads.uploadToTexture(levelRegion(id, streamed, level), levelData);
+            totalResident += assets::textureLevelSize(texture, level);
+        }
+        levelData += assets::textureLevelSize(texture, level);
+    }
+    glTextureParameteri(id, GL_TEXTURE_BASE_LEVEL, streamed.tailLevel);
+    streamed.residentLevel = streamed.tailLevel;
+
+    textures.emplace(id, std::move(streamed));
+    return id;
+}
+
+void TextureStreamer::unregisterTexture(unsigned int id) {
+    auto iterator = textures.find(id);
+    if (iterator == textures.end()) {
+        return;
+    }
+
+    StreamedTexture& texture = iterator->second;
+    if (texture.pending.valid()) texture.decoded = texture.pending.get();
+    uploads.release(texture.decoded.staged);
+    // A queued copy would otherwise land in a deleted texture or read freed memory
+    uploads.flushUntil(texture.uploadTicket);
+
+    for (int level = texture.residentLevel; level < texture.layout.mipLevels; level++) {
+        totalResident -= assets::textureLevelSize(texture.layout, level);
+    }
+    textures.erase(iterator);
+
+    // The last texture of a pack unmaps it, so a rebake can replace the file
+    for (auto pack = packs.begin(); pack != packs.end();) {
+        pack = pack->second.reader.expired() ? packs.erase(pack) : std::next(pack);
+    }
+}
+
+UploadManager::TextureRegion TextureStreamer::levelRegion(unsigned int id, const StreamedTexture& texture, int level) const {
+    UploadManager::TextureRegion region;
+    region.texture = id;
+    region.level = level;
+    region.width = assets::mipDimension(texture.layout.width, level);
+    region.height = assets::mipDimension(texture.layout.height, level);
+    region.compression = texture.layout.compression;
+    region.nrComponents = texture.layout.nrComponents;
+    region.defineLevel = true;
+    return region;
+}
+
+void TextureStreamer::evictLevel(unsigned int id, StreamedTexture& texture) {
+    const Texture& layout = texture.layout;
+    int level = texture.residentLevel;
+    GLenum internalFormat, format;
+    glutil::textureFormats(layout.compression, layout.nrComponents, internalFormat, format);
+
+    // Move the base up before the level is emptied so the texture never samples an incomplete chain
+    glTextureParameteri(id, GL_TEXTURE_BASE_LEVEL, level + 1);
+    glBindTexture(GL_TEXTURE_2D, id);
+    if (layout.compression != TextureCompression::None) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, 0, nullptr);
+    }
+    else {
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture.residentLevel = level + 1;
+    totalResident -= assets::textureLevelSize(layout, level);
+}
+
+void TextureStreamer::update(std::vector<ModelInstance>& models, Camera& camera, float viewportHeight) {
+    frame++;
+    if (textures.empty()) {
+        return;
+    }
+
+    // The finest level any visible mesh asks for, from the size of its bounds on screen
+    for (ModelInstance& instance : models) {
+        if (!instance.shouldDraw) continue;
+
+        ModelResource& model = *instance.resource;
+        for (Mesh& mesh : model.meshes) {
+            if (mesh.materialIndex >= model.materials_loaded.size()) continue;
+
+            glm::mat4 modelMatrix = mesh.model_matrix * instance.model_matrix;
+            glm::vec4 meshMin = modelMatrix * mesh.aabb.minPoint;
+            glm::vec4 meshMax = modelMatrix * mesh.aabb.maxPoint;
+            if (!camera.isInsideFrustum(meshMax, meshMin)) continue;
+
+            glm::vec3 center = (glm::vec3(meshMin) + glm::vec3(meshMax)) * 0.5f;
+            float radius = glm::length(glm::vec3(meshMax) - glm::vec3(meshMin)) * 0.5f;
+            float distance = glm::length(center - camera.Position) - radius;
+            float pixels = std::max(camera.projectedSize(2.0f * radius, distance, viewportHeight), 1.0f);
+
+            for (const Texture& materialTexture : model.materials_loaded[mesh.materialIndex].textures) {
+                auto iterator = textures.find(materialTexture.id);
+                if (iterator == textures.end()) continue;
+
+                StreamedTexture& texture = iterator->second;
+                float texels = (float) std::max(texture.layout.width, texture.layout.height);
+                int level = (int) std::floor(std::log2(texels / pixels) + mipBias);
+                level = std::clamp(level, 0, texture.layout.mipLevels - 1);
+                texture.lastNeeded[level] = frame;
+            }
+        }
+    }
+
+    for (auto& [id, texture] : textures) {
+        int wanted = texture.tailLevel;
+        for (int level = 0; level < texture.tailLevel; level++) {
+            if (texture.lastNeeded[level] != 0 && frame - texture.lastNeeded[level] <= (uint64_t) evictionDelay) {
+                wanted = level;
+                break;
+            }
+        }
+
+        // Decoded levels go to the upload manager, which copies them in under its per frame budget
+        if (texture.pending.valid() &&
+            texture.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            texture.decoded = texture.pending.get();
+            if (!texture.decoded.success) {
+                uploads.release(texture.decoded.staged);
+                texture.decoded = {};
+                texture.pendingLevel = -1;
+            }
+            else {
+                // Once queued the staging space belongs to the upload manager
+                UploadManager::TextureRegion region = levelRegion(id, texture, texture.pendingLevel);
+                texture.uploadTicket = texture.decoded.staged ? uploads.copyToTexture(texture.decoded.staged, region) :
+                                       uploads.uploadToTexture(region, texture.decoded.data.data());
+                texture.decoded.staged = {};
+            }
+        }
+        else if (texture.pendingLevel >= 0 && !texture.pending.valid() && uploads.isComplete(texture.uploadTicket)) {
+            glTextureParameteri(id, GL_TEXTURE_BASE_LEVEL, texture.pendingLevel);
+            texture.residentLevel = texture.pendingLevel;
+            totalResident += assets::textureLevelSize(texture.layout, texture.pendingLevel);
+
+            texture.decoded = {};
+            texture.pendingLevel = -1;
+        }
+
+        if (wanted > texture.residentLevel && texture.residentLevel < texture.tailLevel && texture.pendingLevel < 0) {
+            evictLevel(id, texture);
+        }
+        else if (wanted < texture.residentLevel && texture.pendingLevel < 0) {
+            int level = texture.residentLevel - 1;
+            texture.pendingLevel = level;
+
+            std::shared_ptr<const assets::PackReader> pack = texture.pack;
+            assets::PackEntry entry = texture.entry;
+            size_t size = assets::textureLevelSize(texture.layout, level);
+            texture.pending = JobSystem::shared().submit([this, pack, entry, level, size]() {
+                DecodedLevel decoded;
+                assets::AssetFileView file;
+                Texture layout;
+                if (!pack->view(entry, file)) {
+                    return decoded;
+                }
+
+                // Straight into the staging ring when it has room, so the main thread only issues the copy
+                decoded.staged = uploads.allocate(size);
+                decoded.success = decoded.staged ?
+                    converter.readTextureLevels(file, level, level + 1, layout, decoded.staged.data, size) :
+                    converter.readTextureLevels(file, level, level + 1, layout, decoded.data);
+                return decoded;
+            });
+        }
+    }
+}
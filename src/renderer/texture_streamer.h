@@ -0,0 +1,89 @@
+#pragma once
+
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "assets/asset_pack.h"
+#include "assets/model.h"
+#include "renderer/upload_manager.h"
+#include "utils/camera.h"
+
+// Keeps only the mips each texture needs for its on-screen size in VRAM. The coarse tail is uploaded
+// at load time, finer levels are decoded from the baked pack as jobs straight into staging memory
+// and copied in under the upload budget, and levels no mesh has needed for a while are dropped again.
+//
+// Streamed textures use mutable per level storage with GL_TEXTURE_BASE_LEVEL pointing at the finest
+// resident level, so their ids never change and materials keep working without being patched.
+class TextureStreamer {
+public:
+    explicit TextureStreamer(UploadManager& uploads) : uploads(uploads) {}
+    ~TextureStreamer();
+
+    // Levels at most this many texels on their longest side are always resident
+    int residentTailSize = 128;
+    // Frames a level stays resident after the last frame that needed it
+    int evictionDelay = 120;
+    // Added to the requested level, positive values trade sharpness for memory
+    float mipBias = 0.0f;
+
+    // Creates a GL texture holding only the tail of texture's mips. Returns 0 when the texture can't
+    // stream, because it has no mips or no entry in the pack. The tail is copied from texture.data,
+    // which has to stay alive until uploadTicket completes.
+    unsigned int registerTexture(const std::string& packPath, const Texture& texture, uint64_t& uploadTicket);
+    // Stops streaming the texture, the caller still owns and deletes the GL texture
+    void unregisterTexture(unsigned int id);
+    void update(std::vector<ModelInstance>& models, Camera& camera, float viewportHeight);
+
+    size_t residentBytes() const { return totalResident; }
+    size_t streamedTextureCount() const { return textures.size(); }
+
+private:
+    struct DecodedLevel {
+        UploadManager::Allocation staged;
+        // Only used when the staging ring had no room
+        std::vector<unsigned char> data;
+        bool success = false;
+    };
+
+    struct StreamedTexture {
+        // Size and format, data is never set
+        Texture layout;
+        std::shared_ptr<const assets::PackReader> pack;
+        assets::PackEntry entry{};
+
+        int tailLevel = 0;
+        int residentLevel = 0;
+        // Last frame each level was the finest one some mesh needed
+        std::vector<uint64_t> lastNeeded;
+
+        // Level being decoded or copied, the base level only moves once its copy was issued
+        int pendingLevel = -1;
+        std::future<DecodedLevel> pending;
+        DecodedLevel decoded;
+        uint64_t uploadTicket = 0;
+    };
+
+    // Packs stay mapped while a registered texture streams from them
+    struct OpenPack {
+        std::weak_ptr<const assets::PackReader> reader;
+        // Identifies the file that was mapped, a rebake renames a new one over the path
+        std::filesystem::file_time_type modifiedTime;
+        uintmax_t size = 0;
+    };
+
+    std::shared_ptr<const assets::PackReader> openPack(const std::string& path);
+    UploadManager::TextureRegion levelRegion(unsigned int id, const StreamedTexture& texture, int level) const;
+    void evictLevel(unsigned int id, StreamedTexture& texture);
+
+    UploadManager& uploads;
+    std::unordered_map<unsigned int, StreamedTexture> textures;
+    std::unordered_map<std::string, OpenPack> packs;
+    AssetConverter converter;
+
+    uint64_t frame = 0;
+    size_t totalResident = 0;
+};
@@ -0,0 +1,304 @@
+#include "upload_manager.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "assets/texture_compression.h"
+#include "utils/functions.h"
+
+namespace {
+    // Covers GL_MIN_MAP_BUFFER_ALIGNMENT and the texel size of every format we upload
+    constexpr size_t STAGING_ALIGNMENT = 64;
+
+    size_t alignUp(size_t size) {
+        return (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    }
+
+    size_t regionSize(const UploadManager::TextureRegion& region) {
+        Texture layout;
+        layout.width = region.width;
+        layout.height = region.height;
+        layout.nrComponents = region.nrComponents;
+        layout.compression = region.compression;
+        return assets::textureLevelSize(layout, 0);
+    }
+
+    // pixels is an offset into the bound unpack buffer when one is bound
+    void writeTextureRegion(const UploadManager::TextureRegion& region, const void* pixels, size_t size) {
+        GLenum internalFormat, format;
+        glutil::textureFormats(region.compression, region.nrComponents, internalFormat, format);
+        bool compressed = region.compression != TextureCompression::None;
+
+        // Small levels have rows that aren't a multiple of 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (region.defineLevel) {
+            // Per level storage has no DSA entry point
+            glBindTexture(GL_TEXTURE_2D, region.texture);
+            if (compressed) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, region.level, internalFormat, region.width, region.height, 0,
+                    static_cast<GLsizei>(size), pixels);
+            }
+            else {
+                glTexImage2D(GL_TEXTURE_2D, region.level, internalFormat, region.width, region.height, 0,
+                    format, GL_UNSIGNED_BYTE, pixels);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        else if (compressed) {
+            glCompressedTextureSubImage2D(region.texture, region.level, 0, 0, region.width, region.height,
+                internalFormat, static_cast<GLsizei>(size), pixels);
+        }
+        else {
+            glTextureSubImage2D(region.texture, region.level, 0, 0, region.width, region.height,
+                format, GL_UNSIGNED_BYTE, pixels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+}
+
+bool UploadManager::init(size_t size) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, size, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapNamedBufferRange(buffer, 0, size, flags));
+
+    if (mapped == nullptr) {
+        std::cout << "Failed to map the staging buffer, uploads go straight from client memory\n";
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        return false;
+    }
+    ringSize = size;
+    return true;
+}
+
+UploadManager::Allocation UploadManager::allocate(size_t size) {
+    size_t alignedSize = alignUp(size);
+    if (mapped == nullptr || size == 0 || alignedSize > ringSize) {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+    reclaim();
+
+    // Live regions run from the oldest one's offset up to head, wrapping around the end at most once
+    size_t offset;
+    if (regions.empty()) {
+        offset = 0;
+    }
+    else {
+        size_t tail = regions.front().offset;
+        if (head > tail && head + alignedSize <= ringSize) {
+            offset = head;
+        }
+        else if (head > tail && alignedSize <= tail) {
+            offset = 0;
+        }
+        else if (head < tail && head + alignedSize <= tail) {
+            offset = head;
+        }
+        else {
+            return {};
+        }
+    }
+
+    head = offset + alignedSize;
+    regions.push_back({offset, alignedSize});
+
+    Allocation allocation;
+    allocation.id = firstRegionId + regions.size() - 1;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.data = mapped + offset;
+    return allocation;
+}
+
+void UploadManager::release(const Allocation& allocation) {
+    if (!allocation) return;
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+    regions[allocation.id - firstRegionId].released = true;
+    reclaim();
+}
+
+void UploadManager::reclaim() {
+    while (!regions.empty()) {
+        const Region& region = regions.front();
+        bool finished = region.released || (region.readSerial != 0 && region.readSerial <= completedSerial);
+        if (!finished) break;
+
+        regions.pop_front();
+        firstRegionId++;
+    }
+    if (regions.empty()) head = 0;
+}
+
+size_t UploadManager::usedBytes() const {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    size_t used = 0;
+    for (const Region& region : regions) {
+        if (!region.released) used += region.size;
+    }
+    return used;
+}
+
+uint64_t UploadManager::enqueue(Copy copy) {
+    copy.ticket = nextTicket++;
+    bytesQueued += copy.size;
+    copies.push_back(copy);
+    return copy.ticket;
+}
+
+uint64_t UploadManager::copyToBuffer(const Allocation& source, unsigned int destination, size_t offset) {
+    Copy copy;
+    copy.type = CopyType::Buffer;
+    copy.size = source.size;
+    copy.staged = source;
+    copy.buffer = destination;
+    copy.offset = offset;
+    return enqueue(copy);
+}
+
+uint64_t UploadManager::copyToTexture(const Allocation& source, const TextureRegion& region) {
+    Copy copy;
+    copy.type = CopyType::Texture;
+    copy.size = source.size;
+    copy.staged = source;
+    copy.region = region;
+    return enqueue(copy);
+}
+
+uint64_t UploadManager::uploadToBuffer(unsigned int destination, size_t offset, const void* data, size_t size) {
+    // Big buffers are split so they stream in over several frames instead of waiting for the whole ring
+    size_t chunkSize = mapped != nullptr ? ringSize / 4 : size;
+    uint64_t ticket = issuedTicket;
+    for (size_t done = 0; done < size; done += chunkSize) {
+        Copy copy;
+        copy.type = CopyType::Buffer;
+        copy.size = std::min(chunkSize, size - done);
+        copy.source = static_cast<const unsigned char*>(data) + done;
+        copy.buffer = destination;
+        copy.offset = offset + done;
+        ticket = enqueue(copy);
+    }
+    return ticket;
+}
+
+uint64_t UploadManager::uploadToTexture(const TextureRegion& region, const void* data) {
+    Copy copy;
+    copy.type = CopyType::Texture;
+    copy.size = regionSize(region);
+    copy.source = static_cast<const unsigned char*>(data);
+    copy.region = region;
+    return enqueue(copy);
+}
+
+void UploadManager::flush() {
+    retireFences(false);
+
+    bytesLastFrame = 0;
+    while (!copies.empty()) {
+        Copy& copy = copies.front();
+        if (bytesLastFrame > 0 && bytesLastFrame + copy.size > frameBudget) break;
+        if (!issue(copy, false)) break;
+
+        bytesLastFrame += copy.size;
+        bytesQueued -= copy.size;
+        issuedTicket = copy.ticket;
+        copies.pop_front();
+    }
+
+    fenceFrame();
+}
+
+void UploadManager::flushUntil(uint64_t ticket) {
+    while (!copies.empty() && issuedTicket < ticket) {
+        Copy& copy = copies.front();
+        issue(copy, true);
+
+        bytesQueued -= copy.size;
+        issuedTicket = copy.ticket;
+        copies.pop_front();
+    }
+
+    fenceFrame();
+}
+
+bool UploadManager::issue(Copy& copy, bool waitForSpace) {
+    if (copy.staged) {
+        issueCopy(copy, copy.staged);
+        return true;
+    }
+    if (mapped == nullptr || alignUp(copy.size) > ringSize) {
+        issueFromClientMemory(copy);
+        return true;
+    }
+
+    Allocation staged = allocate(copy.size);
+    while (!staged && waitForSpace) {
+        // Space held by allocations still being written can't be waited for
+        if (fences.empty() && !frameHasCopies) {
+            issueFromClientMemory(copy);
+            return true;
+        }
+        fenceFrame();
+        retireFences(true);
+        staged = allocate(copy.size);
+    }
+    if (!staged) {
+        return false;
+    }
+
+    memcpy(staged.data, copy.source, copy.size);
+    issueCopy(copy, staged);
+    return true;
+}
+
+void UploadManager::issueCopy(const Copy& copy, const Allocation& staged) {
+    if (copy.type == CopyType::Buffer) {
+        glCopyNamedBufferSubData(buffer, copy.buffer, staged.offset, copy.offset, copy.size);
+    }
+    else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        writeTextureRegion(copy.region, reinterpret_cast<const void*>(staged.offset), copy.size);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+    regions[staged.id - firstRegionId].readSerial = currentSerial;
+    frameHasCopies = true;
+}
+
+void UploadManager::issueFromClientMemory(const Copy& copy) {
+    if (copy.type == CopyType::Buffer) {
+        glNamedBufferSubData(copy.buffer, copy.offset, copy.size, copy.source);
+    }
+    else {
+        writeTextureRegion(copy.region, copy.source, copy.size);
+    }
+}
+
+void UploadManager::fenceFrame() {
+    if (!frameHasCopies) return;
+
+    fences.emplace_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), currentSerial);
+    currentSerial++;
+    frameHasCopies = false;
+}
+
+void UploadManager::retireFences(bool waitForOldest) {
+    while (!fences.empty()) {
+        GLbitfield flags = waitForOldest ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+        GLuint64 timeout = waitForOldest ? 1000000000 : 0;
+        GLenum result = glClientWaitSync(fences.front().first, flags, timeout);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+
+        completedSerial = fences.front().second;
+        glDeleteSync(fences.front().first);
+        fences.pop_front();
+        waitForOldest = false;
+    }
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+    reclaim();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "utils/types.h"
+
+// Moves data to the GPU through one persistently mapped, coherent staging buffer used as a ring.
+// Any thread can allocate space in it and write there directly, copies out of it into buffers and
+// textures are issued on the main thread in flush, at most frameBudget bytes per frame, and the
+// space is reused once a fence shows the GPU has finished reading it.
+//
+// Copies are issued in the order they were queued, and every queued copy gets a ticket that
+// isComplete reports on. Data handed in by pointer has to stay alive until its ticket completes.
+class UploadManager {
+public:
+    struct Allocation {
+        uint64_t id = 0;
+        size_t offset = 0, size = 0;
+        unsigned char* data = nullptr;
+
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    struct TextureRegion {
+        unsigned int texture = 0;
+        int level = 0;
+        int width = 0, height = 0;
+        TextureCompression compression = TextureCompression::None;
+        int nrComponents = 4;
+        // Creates the level with glTexImage2D, for textures with mutable storage
+        bool defineLevel = false;
+    };
+
+    // Bytes copied per frame, at least one copy goes through so large ones can't stall
+    size_t frameBudget = 16 * 1024 * 1024;
+
+    // Needs a current GL context. Uploads made before init go straight from client memory.
+    bool init(size_t ringSize = 64 * 1024 * 1024);
+
+    // Any thread. Returns an empty allocation when the ring has no room right now.
+    Allocation allocate(size_t size);
+    // Any thread. Gives back an allocation that will never be copied anywhere.
+    void release(const Allocation& allocation);
+
+    // Main thread only
+    uint64_t copyToBuffer(const Allocation& source, unsigned int buffer, size_t offset);
+    uint64_t copyToTexture(const Allocation& source, const TextureRegion& region);
+    uint64_t uploadToBuffer(unsigned int buffer, size_t offset, const void* data, size_t size);
+    uint64_t uploadToTexture(const TextureRegion& region, const void* data);
+
+    // Issues queued copies within frameBudget and fences them, called once a frame
+    void flush();
+    // Issues everything up to ticket no matter the budget, waiting on the GPU for space if needed
+    void flushUntil(uint64_t ticket);
+    bool isComplete(uint64_t ticket) const { return ticket <= issuedTicket; }
+
+    size_t capacity() const { return ringSize; }
+    size_t usedBytes() const;
+    size_t queuedBytes() const { return bytesQueued; }
+    size_t lastFrameBytes() const { return bytesLastFrame; }
+
+private:
+    enum class CopyType { Buffer, Texture };
+
+    struct Copy {
+        CopyType type = CopyType::Buffer;
+        uint64_t ticket = 0;
+        size_t size = 0;
+        // Either already staged, or client memory that is staged when the copy is issued
+        Allocation staged;
+        const unsigned char* source = nullptr;
+
+        unsigned int buffer = 0;
+        size_t offset = 0;
+        TextureRegion region;
+    };
+
+    // Live ring space in allocation order
+    struct Region {
+        size_t offset, size;
+        bool released = false;
+        // Fence serial of the frame whose copies read it, 0 while it is still being written or queued
+        uint64_t readSerial = 0;
+    };
+
+    uint64_t enqueue(Copy copy);
+    // Returns false when there is no room and nothing in flight to wait for
+    bool issue(Copy& copy, bool waitForSpace);
+    void issueFromClientMemory(const Copy& copy);
+    void issueCopy(const Copy& copy, const Allocation& staged);
+    void fenceFrame();
+    void retireFences(bool waitForOldest);
+    void reclaim();
+
+    unsigned int buffer = 0;
+    unsigned char* mapped = nullptr;
+    size_t ringSize = 0;
+
+    mutable std::mutex ringMutex;
+    std::deque<Region> regions;
+    uint64_t firstRegionId = 1;
+    size_t head = 0;
+
+    std::atomic<uint64_t> completedSerial = 0;
+    uint64_t currentSerial = 1;
+    std::deque<std::pair<GLsync, uint64_t>> fences;
+    bool frameHasCopies = false;
+
+    std::deque<Copy> copies;
+    uint64_t nextTicket = 1;
+    uint64_t issuedTicket = 0;
+    size_t bytesQueued = 0, bytesLastFrame = 0;
+};
@@ -36,8 +36,8 @@ void SceneEditor::render(Camera& camera)
 		ImGui::BeginChild("entities");
 
 		if (objs != nullptr) {
-			for (Model& model : *objs) {
-				renderAsList(model);
+			for (ModelInstance& instance : *objs) {
+				renderAsList(*instance.resource);
 			}
 		}
 
@@ -111,7 +111,7 @@ void SceneEditor::renderDebug(Camera& camera)
 {
 }
 
-void SceneEditor::renderAsList(Model& model) {
+void SceneEditor::renderAsList(ModelResource& model) {
 	ImVec4 color(0.8f, 0.8f, 0.8f, 1.0f);
 
 	bool open = ImGui::TreeNodeEx("##Model", ImGuiTreeNodeFlags_OpenOnArrow);
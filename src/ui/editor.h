@@ -15,11 +15,11 @@ public:
 	SceneEditor() = default;
 
 	void render(Camera& camera);
-	void renderAsList(Model& model);
+	void renderAsList(ModelResource& model);
 	void renderDebug(Camera& camera);
 
 	BaseRenderer* renderer = nullptr;
-	std::vector<Model> *objs = nullptr;
+	std::vector<ModelInstance> *objs = nullptr;
 	Mesh* chosenObj = nullptr;
 	Material* chosenMaterial = nullptr;
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Multi-producer queue with a fixed capacity. push blocks while the queue is full so
+// producers can't run arbitrarily far ahead of the consumer.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    // Returns false if the queue was closed before the item could be added
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) return false;
+
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+
+        return true;
+    }
+
+    // Blocks until an item is available. Returns false once the queue is closed and drained.
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) return false;
+
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+};
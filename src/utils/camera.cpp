@@ -34,6 +34,11 @@ glm::mat4 Camera::getProjectionMatrix(ProjectionType type) const {
     return glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, 0.1f, 100.0f);
 }
 
+float Camera::projectedSize(float worldSize, float distance, float viewportHeight) const {
+    float pixelsPerUnit = viewportHeight / (2.0f * glm::tan(glm::radians(Zoom) * 0.5f));
+    return worldSize / glm::max(distance, zNear) * pixelsPerUnit;
+}
+
 void Camera::processKeyboard(Camera_Movement direction, float deltaTime) {
     float velocity = MovementSpeed * deltaTime;
     if (direction == FORWARD)
@@ -71,6 +71,8 @@ public:
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
     glm::mat4 getViewMatrix() const;
     glm::mat4 getProjectionMatrix(ProjectionType type = PERSPECTIVE) const;
+    // height in pixels of something worldSize tall at the given distance, using the perspective projection's fov
+    float projectedSize(float worldSize, float distance, float viewportHeight) const;
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void processKeyboard(Camera_Movement direction, float deltaTime);
@@ -1,9 +1,18 @@
 #include "functions.h"
 #include "stb_image.h"
+#include "assets/texture_compression.h"
+#include "assets/texture_mips.h"
 
 #include <glad/glad.h>
+#include <cstddef>
 #include <iostream>
 
+// EXT_texture_compression_s3tc, which every desktop driver exposes but the loader doesn't define
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 namespace glutil {
     unsigned int loadFloatTexture(const std::string& path, GLenum format, GLenum storageFormat) {
         int width, height, nrComponents;
@@ -162,6 +171,91 @@ namespace glutil {
         return textureID;
     }
 
+    bool textureFormats(TextureCompression compression, int nrComponents, GLenum& internalFormat, GLenum& format) {
+        format = GL_RGBA;
+        switch (compression) {
+            case TextureCompression::BC1: internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; return true;
+            case TextureCompression::BC3: internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; return true;
+            case TextureCompression::BC4: internalFormat = GL_COMPRESSED_RED_RGTC1; return true;
+            case TextureCompression::BC5: internalFormat = GL_COMPRESSED_RG_RGTC2; return true;
+            case TextureCompression::BC7: internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM; return true;
+            default: break;
+        }
+
+        switch (nrComponents) {
+            case 1: format = GL_RED; internalFormat = GL_R8; return true;
+            case 2: format = GL_RG; internalFormat = GL_RG8; return true;
+            case 3: format = GL_RGB; internalFormat = GL_RGB8; return true;
+            case 4: format = GL_RGBA; internalFormat = GL_RGBA8; return true;
+            default: return false;
+        }
+    }
+
+    unsigned int createTextureStorage(int width, int height, TextureCompression compression, int nrComponents, int levels) {
+        GLenum internalFormat, format;
+        if (!textureFormats(compression, nrComponents, internalFormat, format)) {
+            return 0;
+        }
+
+        unsigned int textureID;
+        glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+        glTextureStorage2D(textureID, levels, internalFormat, width, height);
+
+        // Single channel masks read the same from every channel, like the grey images they came from
+        if (compression == TextureCompression::BC4) {
+            GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+            glTextureParameteriv(textureID, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        return textureID;
+    }
+
+    unsigned int createMippedTexture(int width, int height, int nrComponents, const unsigned char* data, int levels) {
+        GLenum storageFormat, format;
+        unsigned int textureID = createTextureStorage(width, height, TextureCompression::None, nrComponents, levels);
+        if (textureID == 0 || !textureFormats(TextureCompression::None, nrComponents, storageFormat, format)) {
+            return 0;
+        }
+
+        // Small levels have rows that aren't a multiple of 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int level = 0; level < levels; level++) {
+            glTextureSubImage2D(textureID, level, 0, 0, assets::mipDimension(width, level),
+                assets::mipDimension(height, level), format, GL_UNSIGNED_BYTE, data);
+            data += assets::mipLevelSize(width, height, nrComponents, level);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        return textureID;
+    }
+
+    unsigned int createCompressedTexture(int width, int height, TextureCompression compression,
+                                         const unsigned char* data, int levels) {
+        GLenum internalFormat, format;
+        if (compression == TextureCompression::None || !textureFormats(compression, 0, internalFormat, format)) {
+            return 0;
+        }
+        unsigned int textureID = createTextureStorage(width, height, compression, 0, levels);
+
+        Texture layout;
+        layout.width = width;
+        layout.height = height;
+        layout.compression = compression;
+        for (int level = 0; level < levels; level++) {
+            GLsizei size = static_cast<GLsizei>(assets::textureLevelSize(layout, level));
+            glCompressedTextureSubImage2D(textureID, level, 0, 0, assets::mipDimension(width, level),
+                assets::mipDimension(height, level), internalFormat, size, data);
+            data += size;
+        }
+
+        return textureID;
+    }
+
     unsigned int createCubemap(int width, int height, GLenum dataType, GLenum format, GLenum storageFormat, int nrComponents) {
         unsigned int cubemapID;
         
@@ -317,15 +411,20 @@ namespace glutil {
 
     AllocatedBuffer loadVertexBuffer(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, 
         std::vector<VertexType>& endpoints) {
+        return loadVertexBuffer(vertices.data(), vertices.size(), indices.data(), indices.size(), assets::IndexType::UInt32, endpoints);
+    }
+
+    AllocatedBuffer loadVertexBuffer(const Vertex* vertices, size_t vertexCount, const void* indices,
+        size_t indexCount, assets::IndexType indexType, std::vector<VertexType>& endpoints) {
         unsigned int VAO, VBO, EBO;
 
         glCreateVertexArrays(1, &VAO);
 
         glCreateBuffers(1, &VBO);
-        glNamedBufferStorage(VBO, sizeof(Vertex) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferStorage(VBO, sizeof(Vertex) * vertexCount, vertices, GL_DYNAMIC_STORAGE_BIT);
 
         glCreateBuffers(1, &EBO);
-        glNamedBufferStorage(EBO, sizeof(unsigned int) * indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferStorage(EBO, assets::indexTypeSize(indexType) * indexCount, indices, GL_DYNAMIC_STORAGE_BIT);
 
         glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -359,5 +458,51 @@ namespace glutil {
 
         return newBuffer;
     }
+
+    AllocatedBuffer loadVertexBuffer(const assets::PackedVertex* vertices, size_t vertexCount, const void* indices,
+        size_t indexCount, assets::IndexType indexType) {
+        unsigned int VAO, VBO, EBO;
+
+        glCreateVertexArrays(1, &VAO);
+
+        glCreateBuffers(1, &VBO);
+        glNamedBufferStorage(VBO, sizeof(assets::PackedVertex) * vertexCount, vertices, GL_DYNAMIC_STORAGE_BIT);
+
+        glCreateBuffers(1, &EBO);
+        glNamedBufferStorage(EBO, assets::indexTypeSize(indexType) * indexCount, indices, GL_DYNAMIC_STORAGE_BIT);
+
+        // Same locations as the float layout so shaders only have to decode, not rebind.
+        // The bitangent sign is the w of the position and there is no separate ID attribute.
+        glVertexArrayVertexBuffer(VAO, 0, VBO, 0, sizeof(assets::PackedVertex));
+
+        glEnableVertexArrayAttrib(VAO, POSITION);
+        glVertexArrayAttribFormat(VAO, POSITION, 4, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(assets::PackedVertex, position));
+        glVertexArrayAttribBinding(VAO, POSITION, 0);
+
+        glEnableVertexArrayAttrib(VAO, NORMAL);
+        glVertexArrayAttribFormat(VAO, NORMAL, 2, GL_SHORT, GL_TRUE, offsetof(assets::PackedVertex, normal));
+        glVertexArrayAttribBinding(VAO, NORMAL, 0);
+
+        glEnableVertexArrayAttrib(VAO, TEXCOORDS);
+        glVertexArrayAttribFormat(VAO, TEXCOORDS, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(assets::PackedVertex, texCoords));
+        glVertexArrayAttribBinding(VAO, TEXCOORDS, 0);
+
+        glEnableVertexArrayAttrib(VAO, TANGENT);
+        glVertexArrayAttribFormat(VAO, TANGENT, 2, GL_SHORT, GL_TRUE, offsetof(assets::PackedVertex, tangent));
+        glVertexArrayAttribBinding(VAO, TANGENT, 0);
+
+        glVertexArrayElementBuffer(VAO, EBO);
+
+        AllocatedBuffer newBuffer{};
+        newBuffer.VAO = VAO;
+        newBuffer.VBO = VBO;
+        newBuffer.EBO = EBO;
+
+        return newBuffer;
+    }
+
+    GLenum indexTypeToGL(assets::IndexType indexType) {
+        return indexType == assets::IndexType::UInt16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
 };
 
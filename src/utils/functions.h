@@ -5,6 +5,7 @@
 #include <map>
 
 #include "utils/types.h"
+#include "assets/vertex_format.h"
 #include <glad/glad.h>
 
 static std::vector<std::string> defaultFaces = {
@@ -41,6 +42,15 @@ namespace glutil {
     unsigned int createTextureArray(int size, int width, int height, GLenum dataType, GLenum format = GL_RGBA, GLenum storageFormat = GL_RGBA8, void* data = nullptr);
     unsigned int createTexture(int width, int height, GLenum dataType, int nrComponents = 0, unsigned char* data = nullptr, int levels = 4);
     unsigned int createTexture(int width, int height, GLenum dataType, GLenum format = GL_RGBA, GLenum storageFormat = GL_RGBA8, void* data = nullptr, int levels = 4);
+    // GL internal and pixel transfer formats for Texture data, false when there are none
+    bool textureFormats(TextureCompression compression, int nrComponents, GLenum& internalFormat, GLenum& format);
+    // Immutable storage for a chain of levels with the sampling setup of baked textures, no data yet
+    unsigned int createTextureStorage(int width, int height, TextureCompression compression, int nrComponents, int levels);
+    // Uploads every level of a chain stored like assets::generateMips writes it
+    unsigned int createMippedTexture(int width, int height, int nrComponents, const unsigned char* data, int levels);
+    // Same for block compressed chains, see assets::compressTexture
+    unsigned int createCompressedTexture(int width, int height, TextureCompression compression,
+                                         const unsigned char* data, int levels);
 
     unsigned int createCubemap(int width, int height, GLenum dataType, GLenum format = GL_DEPTH_COMPONENT, GLenum storageFormat = GL_DEPTH_COMPONENT, int nrComponents = -1);
     unsigned int loadCubemap(const std::string& path, std::vector<std::string> faces = defaultFaces);
@@ -48,4 +58,9 @@ namespace glutil {
     AllocatedBuffer loadVertexBuffer(std::vector<float>& vertices, std::vector<VertexType>& endpoints = basicEndpoints);
     AllocatedBuffer loadVertexBuffer(std::vector<float>& vertices, std::vector<unsigned int>& indices, std::vector<VertexType>& endpoints = basicEndpoints);
     AllocatedBuffer loadVertexBuffer(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<VertexType>& endpoints = basicEndpoints);
+    AllocatedBuffer loadVertexBuffer(const Vertex* vertices, size_t vertexCount, const void* indices, size_t indexCount, assets::IndexType indexType, std::vector<VertexType>& endpoints = basicEndpoints);
+    // Fixed layout: position (unorm16 x4), normal (snorm16 x2), texcoords (half x2), tangent (snorm16 x2)
+    AllocatedBuffer loadVertexBuffer(const assets::PackedVertex* vertices, size_t vertexCount, const void* indices, size_t indexCount, assets::IndexType indexType);
+
+    GLenum indexTypeToGL(assets::IndexType indexType);
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "material.h"
+#include "shader/shader.h"
 
 template<typename T>
 inline void Material::setUniform(std::string& name, T value)
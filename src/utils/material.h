@@ -1,7 +1,10 @@
 #pragma once
 
 #include "utils/types.h"
-#include "shader/shader.h"
+#include "assets/texture_registry.h"
+
+// Only referenced here, so importing materials doesn't need GL
+class Shader;
 
 struct Material {
 
@@ -13,6 +16,8 @@ struct Material {
 
 	std::vector<Texture> textures;
 	std::vector<std::string> texture_paths;
+	// Keeps shared textures alive while the material uses them, null for ones that aren't registered
+	std::vector<assets::TextureHandle> texture_handles;
 	Shader* shader;
 
 	std::unordered_map<std::string, int> uniformInts;
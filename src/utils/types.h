@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -53,12 +54,24 @@ struct Vertex {
     unsigned int ID;
 };
 
+// How Texture::data is laid out. Block compressed levels are rows of 4x4 texel blocks.
+enum class TextureCompression : uint32_t {
+    // nrComponents bytes per texel
+    None = 0,
+    BC1, BC3, BC4, BC5, BC7
+};
+
 struct Texture {
     unsigned int id = -1;
     std::string type;
     std::string path;
 
     int width = 0, height = 0, nrComponents = 0;
+    // data holds this many levels back to back, largest first
+    int mipLevels = 1;
+    TextureCompression compression = TextureCompression::None;
+    // Identifies the texture in assets::TextureRegistry, 0 when it can't be shared
+    uint64_t contentKey = 0;
 
     unsigned char* data = nullptr;
 };